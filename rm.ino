@@ -33,6 +33,46 @@ static void testFunc2( void *pvParameters )
  Serial.flush();*/
 }
 
+#if( schedTICK_COST_STATS == 1 )
+/* Release benchmark: light tasks with harmonic periods of one and two times
+ * the period of t2, so that many jobs are released on the same ticks. Together
+ * with t1 there are three distinct periods, which fit below the
+ * scheduler task in the four priority levels of Arduino_FreeRTOS. The task
+ * functions do no work, but every job prints its name and wake time (about 35
+ * characters at 9600 baud) before it completes, so the budget covers that.
+ * Needs a board with enough RAM. */
+#if( schedUSE_PREEMPTION_THRESHOLD == 1 )
+	#error The benchmark periods need more priority levels than preemption thresholds leave
+#endif
+#define BENCH_TASKS ( schedMAX_NUMBER_OF_PERIODIC_TASKS - 2 )
+#define BENCH_BUDGET pdMS_TO_TICKS(100)
+TaskHandle_t xBenchHandles[ BENCH_TASKS ];
+
+static void benchFunc( void *pvParameters )
+{
+	(void) pvParameters;
+}
+#endif
+
+#if( schedCONTEXT_SWITCH_STATS == 1 || schedTICK_COST_STATS == 1 )
+/* Prints the statistics every ten seconds. Build the sketch with the feature
+ * under test set to 0 and to 1 and compare the output. */
+static void reportFunc( void *pvParameters )
+{
+	(void) pvParameters;
+	for( ;; )
+	{
+		vTaskDelay( pdMS_TO_TICKS( 10000 ) );
+#if( schedCONTEXT_SWITCH_STATS == 1 )
+		vSchedulerPrintContextSwitchStats();
+#endif
+#if( schedTICK_COST_STATS == 1 )
+		vSchedulerPrintTickCostStats();
+#endif
+	}
+}
+#endif
+
 int main( void )
 {
   Serial.begin(9600);
@@ -48,7 +88,29 @@ int main( void )
 	vSchedulerPeriodicTaskCreate(testFunc1, "t1", configMINIMAL_STACK_SIZE, &c1, 1, &xHandle1, pdMS_TO_TICKS(0), pdMS_TO_TICKS(400), pdMS_TO_TICKS(300), pdMS_TO_TICKS(400));
 	vSchedulerPeriodicTaskCreate(testFunc2, "t2", configMINIMAL_STACK_SIZE, &c2, 2, &xHandle2, pdMS_TO_TICKS(0), pdMS_TO_TICKS(800), pdMS_TO_TICKS(200), pdMS_TO_TICKS(700));
 
+#if( schedUSE_MK_FIRM == 1 )
+	/* t2 may drop one job out of every three under overload. */
+	vSchedulerPeriodicTaskSetMKFirm(&xHandle2, 2, 3);
+#endif
+
+#if( schedUSE_ELASTIC_PERIODS == 1 )
+	/* t2 may be slowed down to half its rate under overload. */
+	vSchedulerPeriodicTaskSetElastic(&xHandle2, pdMS_TO_TICKS(800), pdMS_TO_TICKS(1600), 1);
+#endif
+
+
+
+#if( schedTICK_COST_STATS == 1 )
+	for( int i = 0; i < BENCH_TASKS; i++ )
+	{
+		TickType_t xPeriod = pdMS_TO_TICKS(800) << (i % 2);
+		vSchedulerPeriodicTaskCreate(benchFunc, "b", configMINIMAL_STACK_SIZE, NULL, 1, &xBenchHandles[i], 0, xPeriod, BENCH_BUDGET, xPeriod);
+	}
+#endif
 
+#if( schedCONTEXT_SWITCH_STATS == 1 || schedTICK_COST_STATS == 1 )
+	xTaskCreate(reportFunc, "rep", configMINIMAL_STACK_SIZE + 100, NULL, tskIDLE_PRIORITY, NULL);
+#endif
 
 	vSchedulerStart();
 
@@ -1,8 +1,14 @@
+#include <string.h>
+
 #include "scheduler.h"
 
 #define schedUSE_TCB_ARRAY 1
 #define schedTHREAD_LOCAL_STORAGE_POINTER_INDEX 0
 
+#if( schedUSE_PREEMPTION_THRESHOLD == 1 && schedSCHEDULING_POLICY != schedSCHEDULING_POLICY_RMS )
+	#error schedUSE_PREEMPTION_THRESHOLD requires schedSCHEDULING_POLICY_RMS
+#endif
+
 /* Extended Task control block for managing periodic tasks within this library. */
 typedef struct xExtended_TCB
 {
@@ -39,6 +45,39 @@ typedef struct xExtended_TCB
 		BaseType_t xSuspended; 		/* pdTRUE if the task is suspended. */
 		BaseType_t xMaxExecTimeExceeded; /* pdTRUE when execTime exceeds maxExecTime. */
 	#endif /* schedUSE_TIMING_ERROR_DETECTION_EXECUTION_TIME */
+
+	#if( schedUSE_MK_FIRM == 1 )
+		UBaseType_t uxMKM;			/* Jobs that must meet their deadline in any window of uxMKK jobs. */
+		UBaseType_t uxMKK;			/* Window size in jobs. 0 if the task has hard deadlines. */
+		uint32_t ulMKHistory;		/* Outcomes of recent jobs, bit 0 is the latest. A set bit is a met deadline. */
+	#endif /* schedUSE_MK_FIRM */
+
+	#if( schedUSE_PREEMPTION_THRESHOLD == 1 )
+		UBaseType_t uxPreemptionThreshold; /* Priority the jobs of the task run at. */
+		BaseType_t xStackGroup;		/* Tasks in the same group never preempt each other. */
+	#endif /* schedUSE_PREEMPTION_THRESHOLD */
+
+	#if( schedUSE_ELASTIC_PERIODS == 1 )
+		TickType_t xMinPeriod;		/* Nominal (shortest) period. */
+		TickType_t xMaxPeriod;		/* Longest period the task may be stretched to. */
+		UBaseType_t uxElasticity;	/* Elastic coefficient. 0 if the period is fixed. */
+		BaseType_t xImplicitDeadline; /* pdTRUE if the relative deadline follows the period. */
+		TickType_t xPendingPeriod;	/* Period that takes effect at the next job boundary. */
+		TickType_t xMeasuredExecTime; /* Execution time estimate used for adaptation. */
+		TickType_t xWindowExecTime;	/* Longest job execution time since the last adaptation. */
+	#endif /* schedUSE_ELASTIC_PERIODS */
+
+	#if( schedUSE_RELEASE_ENGINE == 1 )
+		TickType_t xNextReleaseTime; /* Absolute time of the next release. */
+		TickType_t xJobReleaseTime;	/* Release time of the latest job given to the task. */
+		BaseType_t xNextInSlot;		/* Index of the next TCB in the same timer wheel slot, -1 at the end. */
+	#endif /* schedUSE_RELEASE_ENGINE */
+
+	#if( schedUSE_WCET_CALIBRATION == 1 )
+		uint16_t usExecTimeHistogram[ schedWCET_HISTOGRAM_BINS ]; /* Recorded jobs per execution time bin. */
+		uint16_t usCalibrationJobs;	/* Number of recorded jobs. */
+		TickType_t xObservedMaxExecTime; /* Longest recorded execution time. */
+	#endif /* schedUSE_WCET_CALIBRATION */
 	
 	/* add if you need anything else */	
 	
@@ -48,6 +87,10 @@ typedef struct xExtended_TCB
 
 #if( schedUSE_TCB_ARRAY == 1 )
 	static BaseType_t prvGetTCBIndexFromHandle( TaskHandle_t xTaskHandle );
+	#if( schedUSE_MK_FIRM == 1 || schedUSE_ELASTIC_PERIODS == 1 )
+		/* Find index of the TCB created with given task handle pointer. Return -1 if there is none. */
+		static BaseType_t prvGetTCBIndexFromHandlePointer( TaskHandle_t *pxTaskHandle );
+	#endif /* schedUSE_MK_FIRM || schedUSE_ELASTIC_PERIODS */
 	static void prvInitTCBArray( void );
 	/* Find index for an empty entry in xTCBArray. Return -1 if there is no empty entry. */
 	static BaseType_t prvFindEmptyElementIndexTCB( void );
@@ -61,14 +104,84 @@ typedef struct xExtended_TCB
 
 static TickType_t xSystemStartTime = 0;
 
+/* Utilization C / T in parts per 10000, rounded up so that schedulability tests stay safe. */
+#define schedUTILIZATION( xExecTime, xPeriod ) ( ( ( uint32_t ) ( xExecTime ) * 10000UL + ( uint32_t ) ( xPeriod ) - 1 ) / ( uint32_t ) ( xPeriod ) )
+
 static void prvPeriodicTaskCode( void *pvParameters );
 static void prvCreateAllTasks( void );
+static void prvWaitForNextRelease( SchedTCB_t *pxTCB );
+
+#if( schedUSE_RELEASE_ENGINE == 1 )
+	static void prvReleaseEngineInsert( BaseType_t xIndex );
+	static void prvReleaseEngineRemove( BaseType_t xIndex );
+	static void prvReleaseEngineWait( SchedTCB_t *pxTCB );
+	static void prvReleaseEngineTick( TickType_t xTickCount );
+	static void prvReleaseEngineStart( void );
+#endif /* schedUSE_RELEASE_ENGINE */
+
+#if( schedUSE_MK_FIRM == 1 )
+	static uint32_t prvMKMask( UBaseType_t uxBits );
+	static void prvMKRecordJob( SchedTCB_t *pxTCB, BaseType_t xDeadlineMet );
+	static UBaseType_t prvMKMetInWindow( SchedTCB_t *pxTCB, UBaseType_t uxJobs );
+	static void prvMKSignalOverload( TickType_t xTickCount );
+	static void prvMKSignalOverloadFromISR( TickType_t xTickCount );
+	static void prvMKCheckOverrun( TickType_t xTickCount );
+	static BaseType_t prvMKSkipJob( SchedTCB_t *pxTCB, TickType_t xTickCount );
+	static void prvMKJobCompleted( SchedTCB_t *pxTCB, TickType_t xTickCount );
+#endif /* schedUSE_MK_FIRM */
 
 
 #if( schedSCHEDULING_POLICY == schedSCHEDULING_POLICY_RMS)
 	static void prvSetFixedPriorities( void );	
+
+	#if( schedUSE_PREEMPTION_THRESHOLD == 1 )
+		/* RMS priority levels are two apart, so that a preemption threshold can
+		 * lie strictly between the levels of two tasks. A threshold equal to the
+		 * priority of another task would only make the two time slice. */
+		#define schedRMS_PRIORITY_STEP 2
+	#else
+		#define schedRMS_PRIORITY_STEP 1
+	#endif /* schedUSE_PREEMPTION_THRESHOLD */
 #endif /* schedSCHEDULING_POLICY_RMS */
 
+#if( schedUSE_PREEMPTION_THRESHOLD == 1 || schedUSE_WCET_CALIBRATION == 1 )
+	static BaseType_t prvTaskIsSchedulable( SchedTCB_t *pxTCB );
+	static BaseType_t prvTaskSetIsSchedulable( void );
+#endif /* schedUSE_PREEMPTION_THRESHOLD || schedUSE_WCET_CALIBRATION */
+
+#if( schedUSE_PREEMPTION_THRESHOLD == 1 )
+	/* Priority a job of the task runs at. */
+	#define schedJOB_PRIORITY( pxTCB ) ( ( pxTCB )->uxPreemptionThreshold )
+
+	static BaseType_t prvIsTaskPriority( UBaseType_t uxPriority );
+	static void prvAssignPreemptionThresholds( void );
+	static void prvAssignStackGroups( void );
+	#if( schedPRINT_PREEMPTION_THRESHOLD_REPORT == 1 || schedCONTEXT_SWITCH_STATS == 1 )
+		static uint32_t prvHyperperiod( void );
+		static uint32_t prvPreemptionBound( BaseType_t xUseThresholds );
+	#endif /* schedPRINT_PREEMPTION_THRESHOLD_REPORT || schedCONTEXT_SWITCH_STATS */
+	#if( schedPRINT_PREEMPTION_THRESHOLD_REPORT == 1 )
+		static void prvPrintPreemptionThresholdReport( void );
+	#endif /* schedPRINT_PREEMPTION_THRESHOLD_REPORT */
+#else
+	#define schedJOB_PRIORITY( pxTCB ) ( ( pxTCB )->uxPriority )
+#endif /* schedUSE_PREEMPTION_THRESHOLD */
+
+#if( schedUSE_ELASTIC_PERIODS == 1 )
+	/* Whether jobs of the task are stopped at their worst-case execution time.
+	 * Elastic tasks are not, their overruns are handled by stretching periods. */
+	#define schedEXEC_TIME_IS_ENFORCED( pxTCB ) ( 0 == ( pxTCB )->uxElasticity )
+#else
+	#define schedEXEC_TIME_IS_ENFORCED( pxTCB ) ( pdTRUE )
+#endif /* schedUSE_ELASTIC_PERIODS */
+
+#if( schedUSE_WCET_CALIBRATION == 1 )
+	static void prvCalibrationRecordJob( SchedTCB_t *pxTCB );
+	static TickType_t prvCalibrationPercentile( SchedTCB_t *pxTCB, UBaseType_t uxPercent );
+	static TickType_t prvCalibrationBudget( SchedTCB_t *pxTCB );
+	static void prvCalibrationCheckDone( void );
+#endif /* schedUSE_WCET_CALIBRATION */
+
 #if( schedUSE_SCHEDULER_TASK == 1 )
 	static void prvSchedulerCheckTimingError( TickType_t xTickCount, SchedTCB_t *pxTCB );
 	static void prvSchedulerFunction( void );
@@ -81,9 +194,14 @@ static void prvCreateAllTasks( void );
 		static void prvCheckDeadline( SchedTCB_t *pxTCB, TickType_t xTickCount );				
 	#endif /* schedUSE_TIMING_ERROR_DETECTION_DEADLINE */
 
-	#if( schedUSE_TIMING_ERROR_DETECTION_EXECUTION_TIME == 1 )
+	#if( schedUSE_TIMING_ERROR_DETECTION_EXECUTION_TIME == 1 && schedUSE_WCET_CALIBRATION == 0 )
 		static void prvExecTimeExceedHook( TickType_t xTickCount, SchedTCB_t *pxCurrentTask );
-	#endif /* schedUSE_TIMING_ERROR_DETECTION_EXECUTION_TIME */
+	#endif /* schedUSE_TIMING_ERROR_DETECTION_EXECUTION_TIME && !schedUSE_WCET_CALIBRATION */
+
+	#if( schedUSE_ELASTIC_PERIODS == 1 )
+		static uint32_t prvRMSUtilizationBound( BaseType_t xTaskCount );
+		static void prvElasticAdaptPeriods( void );
+	#endif /* schedUSE_ELASTIC_PERIODS */
 	
 #endif /* schedUSE_SCHEDULER_TASK */
 
@@ -101,6 +219,42 @@ static void prvCreateAllTasks( void );
 	static TaskHandle_t xSchedulerHandle = NULL; /* useful. why? */
 #endif /* schedUSE_SCHEDULER_TASK */
 
+#if( schedUSE_ELASTIC_PERIODS == 1 )
+	static void prvElasticJobBoundary( SchedTCB_t *pxTCB );
+#endif /* schedUSE_ELASTIC_PERIODS */
+
+#if( schedUSE_RELEASE_ENGINE == 1 )
+	#if( ( schedRELEASE_WHEEL_SIZE & ( schedRELEASE_WHEEL_SIZE - 1 ) ) != 0 )
+		#error schedRELEASE_WHEEL_SIZE must be a power of two
+	#endif
+	/* Timer wheel of release times. Each slot is a list of xTCBArray indices
+	 * linked through xNextInSlot, holding TCBs whose next release time modulo
+	 * schedRELEASE_WHEEL_SIZE equals the slot index. */
+	static BaseType_t xReleaseWheel[ schedRELEASE_WHEEL_SIZE ];
+	/* Last tick whose releases have been handled. */
+	static TickType_t xReleaseEngineLastTick = 0;
+#endif /* schedUSE_RELEASE_ENGINE */
+
+#if( schedTICK_COST_STATS == 1 )
+	static uint32_t ulJobReleaseCount = 0;		/* Jobs released to periodic tasks. */
+	static uint32_t ulTickCostTicks = 0;		/* Ticks measured. */
+	static uint32_t ulTickCostMicros = 0;		/* Time spent in tick processing. */
+	static uint32_t ulTickCostMaxMicros = 0;	/* Longest single tick. */
+	static uint32_t ulTickStartMicros = 0;		/* Start of the current tick. */
+	static BaseType_t xTickStartTraced = pdFALSE; /* pdTRUE once vSchedulerTraceTickStart has been called. */
+#endif /* schedTICK_COST_STATS */
+
+#if( schedCONTEXT_SWITCH_STATS == 1 )
+	static TaskHandle_t xLastSampledTask = NULL; /* Task running at the previous tick. */
+	static uint32_t ulSampledSwitches = 0;		/* Ticks on which a different task was running. */
+	static uint32_t ulSampledPreemptions = 0;	/* Of those, switches away from an unfinished periodic job. */
+#endif /* schedCONTEXT_SWITCH_STATS */
+
+#if( schedUSE_MK_FIRM == 1 )
+	static BaseType_t xMKOverloaded = pdFALSE; /* pdTRUE after a miss or an overrun until xMKOverloadEndTime. */
+	static TickType_t xMKOverloadEndTime = 0;
+#endif /* schedUSE_MK_FIRM */
+
 
 #if( schedUSE_TCB_ARRAY == 1 )
 	/* Returns index position in xTCBArray of TCB with same task handle as parameter. */
@@ -126,6 +280,23 @@ static void prvCreateAllTasks( void );
 		return -1;
 	}
 
+	#if( schedUSE_MK_FIRM == 1 || schedUSE_ELASTIC_PERIODS == 1 )
+		/* Returns index position in xTCBArray of TCB created with given task handle pointer. */
+		static BaseType_t prvGetTCBIndexFromHandlePointer( TaskHandle_t *pxTaskHandle )
+		{
+			BaseType_t xIndex;
+
+			for( xIndex = 0; xIndex < schedMAX_NUMBER_OF_PERIODIC_TASKS; xIndex++ )
+			{
+				if( pdTRUE == xTCBArray[ xIndex ].xInUse && xTCBArray[ xIndex ].pxTaskHandle == pxTaskHandle )
+				{
+					return xIndex;
+				}
+			}
+			return -1;
+		}
+	#endif /* schedUSE_MK_FIRM || schedUSE_ELASTIC_PERIODS */
+
 	/* Initializes xTCBArray. */
 	static void prvInitTCBArray( void )
 	{
@@ -161,6 +332,11 @@ static void prvCreateAllTasks( void );
 
 		if( xTCBArray[ pdTRUE == xIndex].xInUse )
 		{
+			#if( schedUSE_RELEASE_ENGINE == 1 )
+				taskENTER_CRITICAL();
+				prvReleaseEngineRemove( xIndex );
+				taskEXIT_CRITICAL();
+			#endif /* schedUSE_RELEASE_ENGINE */
 			xTCBArray[ xIndex ].xInUse = pdFALSE;
 			xTaskCounter--;
 		}
@@ -187,6 +363,297 @@ static void prvCreateAllTasks( void );
 #endif /* schedUSE_TCB_ARRAY */
 
 
+#if( schedUSE_MK_FIRM == 1 )
+	/* Returns a mask with the lowest uxBits bits set. */
+	static uint32_t prvMKMask( UBaseType_t uxBits )
+	{
+		return ( uxBits >= 32 ) ? 0xFFFFFFFFUL : ( ( 1UL << uxBits ) - 1UL );
+	}
+
+	/* Shifts the outcome of the latest job into the job history of the task. */
+	static void prvMKRecordJob( SchedTCB_t *pxTCB, BaseType_t xDeadlineMet )
+	{
+		pxTCB->ulMKHistory = ( pxTCB->ulMKHistory << 1 ) | ( ( pdTRUE == xDeadlineMet ) ? 1UL : 0UL );
+	}
+
+	/* Returns the number of met deadlines among the latest uxJobs jobs. */
+	static UBaseType_t prvMKMetInWindow( SchedTCB_t *pxTCB, UBaseType_t uxJobs )
+	{
+		uint32_t ulWindow = pxTCB->ulMKHistory & prvMKMask( uxJobs );
+		UBaseType_t uxMet = 0;
+
+		while( 0 != ulWindow )
+		{
+			ulWindow &= ulWindow - 1;
+			uxMet++;
+		}
+		return uxMet;
+	}
+
+	/* Marks the task set as overloaded for the next schedMK_OVERLOAD_HOLD_TICKS. */
+	static void prvMKSignalOverload( TickType_t xTickCount )
+	{
+		taskENTER_CRITICAL();
+		prvMKSignalOverloadFromISR( xTickCount );
+		taskEXIT_CRITICAL();
+	}
+
+	/* Same as prvMKSignalOverload, for callers that run with interrupts disabled. */
+	static void prvMKSignalOverloadFromISR( TickType_t xTickCount )
+	{
+		xMKOverloaded = pdTRUE;
+		xMKOverloadEndTime = xTickCount + schedMK_OVERLOAD_HOLD_TICKS;
+	}
+
+	/* Called by the scheduler task. A job still running one period after its
+	 * release is an overrun, so the task set is marked as overloaded before the
+	 * overrun turns into deadline misses. */
+	static void prvMKCheckOverrun( TickType_t xTickCount )
+	{
+		BaseType_t xIndex;
+		SchedTCB_t *pxTCB;
+
+		for( xIndex = 0; xIndex < schedMAX_NUMBER_OF_PERIODIC_TASKS; xIndex++ )
+		{
+			pxTCB = &xTCBArray[ xIndex ];
+			if( pdTRUE == pxTCB->xInUse && pdFALSE == pxTCB->xWorkIsDone &&
+				( signed ) ( xTickCount - ( pxTCB->xLastWakeTime + pxTCB->xPeriod ) ) >= 0 )
+			{
+				prvMKSignalOverload( xTickCount );
+				return;
+			}
+		}
+	}
+
+	/* Called at release time. Returns pdTRUE if the job is optional and should be
+	 * dropped. This is the Distance-Based Priority rule reduced to a drop test: a
+	 * job is mandatory when its distance to a dynamic failure is zero, i.e. when
+	 * dropping it would leave fewer than m met deadlines in the last k jobs. All
+	 * other jobs are optional and are dropped greedily while the task set is
+	 * overloaded. Overload is signalled by deadline misses, by jobs finishing more
+	 * than a period after their release, and by releases that find the previous
+	 * job still running, so dropping starts before deadlines are missed when an
+	 * overrun is detected first. */
+	static BaseType_t prvMKSkipJob( SchedTCB_t *pxTCB, TickType_t xTickCount )
+	{
+		BaseType_t xOverloaded;
+
+		if( 0 == pxTCB->uxMKK )
+		{
+			return pdFALSE;
+		}
+
+		taskENTER_CRITICAL();
+		if( pdTRUE == xMKOverloaded && ( signed ) ( xMKOverloadEndTime - xTickCount ) <= 0 )
+		{
+			xMKOverloaded = pdFALSE;
+		}
+		xOverloaded = xMKOverloaded;
+		taskEXIT_CRITICAL();
+
+		if( pdFALSE == xOverloaded )
+		{
+			return pdFALSE;
+		}
+
+		/* The previous k - 1 jobs and this one make up the window. */
+		if( prvMKMetInWindow( pxTCB, pxTCB->uxMKK - 1 ) < pxTCB->uxMKM )
+		{
+			return pdFALSE;
+		}
+
+		/* A dropped job counts as a missed one. */
+		prvMKRecordJob( pxTCB, pdFALSE );
+		return pdTRUE;
+	}
+
+	/* Called when a job has finished. Records whether it met its deadline, and
+	 * signals an overload if it missed its deadline or overran its period. */
+	static void prvMKJobCompleted( SchedTCB_t *pxTCB, TickType_t xTickCount )
+	{
+		BaseType_t xDeadlineMet = ( ( signed ) ( pxTCB->xLastWakeTime + pxTCB->xRelativeDeadline - xTickCount ) >= 0 ) ? pdTRUE : pdFALSE;
+
+		prvMKRecordJob( pxTCB, xDeadlineMet );
+		if( pdFALSE == xDeadlineMet || ( signed ) ( xTickCount - ( pxTCB->xLastWakeTime + pxTCB->xPeriod ) ) > 0 )
+		{
+			prvMKSignalOverload( xTickCount );
+		}
+	}
+#endif /* schedUSE_MK_FIRM */
+
+
+#if( schedUSE_RELEASE_ENGINE == 1 )
+	/* Links a TCB into the wheel slot of its next release time. A release time
+	 * at or before the last handled tick is moved forward by whole periods, so
+	 * the task keeps its phase. Must be called with interrupts disabled. */
+	static void prvReleaseEngineInsert( BaseType_t xIndex )
+	{
+		SchedTCB_t *pxTCB = &xTCBArray[ xIndex ];
+		BaseType_t xSlot;
+
+		while( ( signed ) ( pxTCB->xNextReleaseTime - xReleaseEngineLastTick ) <= 0 )
+		{
+			pxTCB->xNextReleaseTime += pxTCB->xPeriod;
+		}
+
+		xSlot = pxTCB->xNextReleaseTime & ( schedRELEASE_WHEEL_SIZE - 1 );
+		pxTCB->xNextInSlot = xReleaseWheel[ xSlot ];
+		xReleaseWheel[ xSlot ] = xIndex;
+	}
+
+	/* Unlinks a TCB from the wheel. Must be called with interrupts disabled. */
+	static void prvReleaseEngineRemove( BaseType_t xIndex )
+	{
+		BaseType_t *pxLink = &xReleaseWheel[ xTCBArray[ xIndex ].xNextReleaseTime & ( schedRELEASE_WHEEL_SIZE - 1 ) ];
+
+		while( -1 != *pxLink )
+		{
+			if( xIndex == *pxLink )
+			{
+				*pxLink = xTCBArray[ xIndex ].xNextInSlot;
+				return;
+			}
+			pxLink = &xTCBArray[ *pxLink ].xNextInSlot;
+		}
+	}
+
+	/* Blocks the calling periodic task until the release engine releases it.
+	 * Releases that happened while the previous job overran are collapsed into
+	 * one job, whose release time is the latest one. */
+	static void prvReleaseEngineWait( SchedTCB_t *pxTCB )
+	{
+		ulTaskNotifyTake( pdTRUE, portMAX_DELAY );
+
+		taskENTER_CRITICAL();
+		pxTCB->xLastWakeTime = pxTCB->xJobReleaseTime;
+		taskEXIT_CRITICAL();
+	}
+
+	/* Called from the tick hook. Releases every job due since the last call.
+	 * The hook does not see every tick count value: ticks that occur while the
+	 * scheduler is suspended are added later in one go. So every wheel slot from
+	 * the last handled tick up to this one is visited, at most one full turn. */
+	static void prvReleaseEngineTick( TickType_t xTickCount )
+	{
+		TickType_t xElapsed = xTickCount - xReleaseEngineLastTick;
+		TickType_t xSlotTick = xReleaseEngineLastTick;
+		BaseType_t xSlot, xIndex, xNext;
+		BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+		SchedTCB_t *pxTCB;
+
+		if( xElapsed > schedRELEASE_WHEEL_SIZE )
+		{
+			xElapsed = schedRELEASE_WHEEL_SIZE;
+		}
+		xReleaseEngineLastTick = xTickCount;
+
+		for( ; 0 != xElapsed; xElapsed-- )
+		{
+			xSlotTick++;
+			xSlot = xSlotTick & ( schedRELEASE_WHEEL_SIZE - 1 );
+			xIndex = xReleaseWheel[ xSlot ];
+
+			/* Detach the slot, then put every entry back into the slot of its next release. */
+			xReleaseWheel[ xSlot ] = -1;
+			while( -1 != xIndex )
+			{
+				pxTCB = &xTCBArray[ xIndex ];
+				xNext = pxTCB->xNextInSlot;
+
+				if( ( signed ) ( pxTCB->xNextReleaseTime - xTickCount ) <= 0 )
+				{
+					#if( schedUSE_MK_FIRM == 1 )
+						/* Released while the previous job is still running. */
+						if( pdFALSE == pxTCB->xWorkIsDone )
+						{
+							prvMKSignalOverloadFromISR( xTickCount );
+						}
+					#endif /* schedUSE_MK_FIRM */
+					/* Releases missed in between are collapsed into the latest one. */
+					pxTCB->xJobReleaseTime = pxTCB->xNextReleaseTime
+							+ ( ( TickType_t ) ( xTickCount - pxTCB->xNextReleaseTime ) / pxTCB->xPeriod ) * pxTCB->xPeriod;
+					vTaskNotifyGiveFromISR( *pxTCB->pxTaskHandle, &xHigherPriorityTaskWoken );
+				}
+				prvReleaseEngineInsert( xIndex );
+
+				xIndex = xNext;
+			}
+		}
+	}
+
+	/* Called from vSchedulerStart once the tasks exist. Tasks with zero phase are
+	 * released right away, all others at their phase. */
+	static void prvReleaseEngineStart( void )
+	{
+		BaseType_t xIndex;
+		SchedTCB_t *pxTCB;
+
+		xReleaseEngineLastTick = xSystemStartTime;
+		for( xIndex = 0; xIndex < xTaskCounter; xIndex++ )
+		{
+			pxTCB = &xTCBArray[ xIndex ];
+			if( 0 == pxTCB->xReleaseTime )
+			{
+				pxTCB->xJobReleaseTime = xSystemStartTime;
+				xTaskNotifyGive( *pxTCB->pxTaskHandle );
+				pxTCB->xNextReleaseTime = xSystemStartTime + pxTCB->xPeriod;
+			}
+			else
+			{
+				pxTCB->xNextReleaseTime = xSystemStartTime + pxTCB->xReleaseTime;
+			}
+			prvReleaseEngineInsert( xIndex );
+		}
+	}
+#endif /* schedUSE_RELEASE_ENGINE */
+
+
+#if( schedUSE_ELASTIC_PERIODS == 1 )
+	/* Called between two jobs. Applies a period chosen by the scheduler task. */
+	static void prvElasticJobBoundary( SchedTCB_t *pxTCB )
+	{
+		taskENTER_CRITICAL();
+		if( pxTCB->xPendingPeriod != pxTCB->xPeriod )
+		{
+			pxTCB->xPeriod = pxTCB->xPendingPeriod;
+			if( pdTRUE == pxTCB->xImplicitDeadline )
+			{
+				pxTCB->xRelativeDeadline = pxTCB->xPeriod;
+			}
+
+			#if( schedUSE_RELEASE_ENGINE == 1 )
+				/* Move the next release to one new period after the latest release.
+				 * That is the next job's release if it has already been given. */
+				prvReleaseEngineRemove( pxTCB - xTCBArray );
+				pxTCB->xNextReleaseTime = pxTCB->xJobReleaseTime + pxTCB->xPeriod;
+				prvReleaseEngineInsert( pxTCB - xTCBArray );
+			#endif /* schedUSE_RELEASE_ENGINE */
+		}
+		taskEXIT_CRITICAL();
+	}
+#endif /* schedUSE_ELASTIC_PERIODS */
+
+/* Blocks the calling periodic task until the release of its next job. */
+static void prvWaitForNextRelease( SchedTCB_t *pxTCB )
+{
+	#if( schedUSE_ELASTIC_PERIODS == 1 )
+		prvElasticJobBoundary( pxTCB );
+	#endif /* schedUSE_ELASTIC_PERIODS */
+
+	#if( schedUSE_RELEASE_ENGINE == 1 )
+		prvReleaseEngineWait( pxTCB );
+	#else
+		vTaskDelayUntil( &pxTCB->xLastWakeTime, pxTCB->xPeriod );
+	#endif /* schedUSE_RELEASE_ENGINE */
+
+	#if( schedTICK_COST_STATS == 1 )
+		taskENTER_CRITICAL();
+		ulJobReleaseCount++;
+		taskEXIT_CRITICAL();
+	#endif /* schedTICK_COST_STATS */
+}
+
+
 /* The whole function code that is executed by every periodic task.
  * This function wraps the task code specified by the user. */
 static void prvPeriodicTaskCode( void *pvParameters )
@@ -203,10 +670,15 @@ static void prvPeriodicTaskCode( void *pvParameters )
     /* Check the handle is not NULL. */
 	configASSERT( NULL != pxThisTask );
 
-	if( 0 != pxThisTask->xReleaseTime )
-	{
-		vTaskDelayUntil( &pxThisTask->xLastWakeTime, pxThisTask->xReleaseTime );
-	}
+	#if( schedUSE_RELEASE_ENGINE == 1 )
+		/* Every job, including the first one after a restart, is released by the release engine. */
+		prvReleaseEngineWait( pxThisTask );
+	#else
+		if( 0 != pxThisTask->xReleaseTime )
+		{
+			vTaskDelayUntil( &pxThisTask->xLastWakeTime, pxThisTask->xReleaseTime );
+		}
+	#endif /* schedUSE_RELEASE_ENGINE */
 
     /* If required, use the handle to obtain further information about the task. */
   
@@ -220,17 +692,48 @@ static void prvPeriodicTaskCode( void *pvParameters )
 	#if( schedUSE_TIMING_ERROR_DETECTION_DEADLINE == 1 )
 		pxThisTask->xExecutedOnce = pdTRUE;
 	#endif /* schedUSE_TIMING_ERROR_DETECTION_DEADLINE */
-	if( 0 == pxThisTask->xReleaseTime )
-	{
-		pxThisTask->xLastWakeTime = xSystemStartTime;
-	}
+	#if( schedUSE_RELEASE_ENGINE == 0 )
+		if( 0 == pxThisTask->xReleaseTime )
+		{
+			pxThisTask->xLastWakeTime = xSystemStartTime;
+		}
+	#endif /* schedUSE_RELEASE_ENGINE */
 
 	for( ; ; )
 	{	
+		#if( schedUSE_MK_FIRM == 1 )
+			/* Drop optional jobs at release time while the task set is overloaded. */
+			if( pdTRUE == prvMKSkipJob( pxThisTask, xTaskGetTickCount() ) )
+			{
+				prvWaitForNextRelease( pxThisTask );
+				continue;
+			}
+		#endif /* schedUSE_MK_FIRM */
+
+		#if( schedUSE_PREEMPTION_THRESHOLD == 1 )
+			/* Only tasks with a priority above the threshold may preempt the job. */
+			if( pxThisTask->uxPreemptionThreshold > pxThisTask->uxPriority )
+			{
+				vTaskPrioritySet( NULL, pxThisTask->uxPreemptionThreshold );
+			}
+		#endif /* schedUSE_PREEMPTION_THRESHOLD */
+
 		/* Execute the task function specified by the user. */
     pxThisTask->xWorkIsDone = pdFALSE;
 		pxThisTask->pvTaskCode( pvParameters );
     pxThisTask->xWorkIsDone = pdTRUE;
+
+		#if( schedUSE_PREEMPTION_THRESHOLD == 1 )
+			/* Back to the RMS priority. Preemptions deferred during the job happen here. */
+			if( pxThisTask->uxPreemptionThreshold > pxThisTask->uxPriority )
+			{
+				vTaskPrioritySet( NULL, pxThisTask->uxPriority );
+			}
+		#endif /* schedUSE_PREEMPTION_THRESHOLD */
+
+		#if( schedUSE_MK_FIRM == 1 )
+			prvMKJobCompleted( pxThisTask, xTaskGetTickCount() );
+		#endif /* schedUSE_MK_FIRM */
 		
 		//taskENTER_CRITICAL();
 		Serial.println("Task");
@@ -245,9 +748,13 @@ static void prvPeriodicTaskCode( void *pvParameters )
 
 		//taskEXIT_CRITICAL();
 			
+		#if( schedUSE_WCET_CALIBRATION == 1 )
+			prvCalibrationRecordJob( pxThisTask );
+		#endif /* schedUSE_WCET_CALIBRATION */
+
 		pxThisTask->xExecTime = 0;   
         
-		vTaskDelayUntil( &pxThisTask->xLastWakeTime, pxThisTask->xPeriod );
+		prvWaitForNextRelease( pxThisTask );
 	}
 }
 
@@ -303,6 +810,48 @@ void vSchedulerPeriodicTaskCreate( TaskFunction_t pvTaskCode, const char *pcName
 		pxNewTCB->xMaxExecTimeExceeded = pdFALSE;
 	#endif /* schedUSE_TIMING_ERROR_DETECTION_EXECUTION_TIME */	
 
+	#if( schedUSE_PREEMPTION_THRESHOLD == 1 )
+		/* member initialization */
+		pxNewTCB->uxPreemptionThreshold = uxPriority;
+		pxNewTCB->xStackGroup = -1;
+	#endif /* schedUSE_PREEMPTION_THRESHOLD */
+
+	#if( schedUSE_ELASTIC_PERIODS == 1 )
+		/* Fixed period until vSchedulerPeriodicTaskSetElastic is called. */
+		pxNewTCB->xMinPeriod = xPeriodTick;
+		pxNewTCB->xMaxPeriod = xPeriodTick;
+		pxNewTCB->uxElasticity = 0;
+		pxNewTCB->xImplicitDeadline = ( xDeadlineTick == xPeriodTick ) ? pdTRUE : pdFALSE;
+		pxNewTCB->xPendingPeriod = xPeriodTick;
+		pxNewTCB->xMeasuredExecTime = xMaxExecTimeTick;
+		pxNewTCB->xWindowExecTime = 0;
+	#endif /* schedUSE_ELASTIC_PERIODS */
+
+	#if( schedUSE_RELEASE_ENGINE == 1 )
+		/* Linked into the timer wheel by vSchedulerStart. */
+		pxNewTCB->xNextReleaseTime = 0;
+		pxNewTCB->xJobReleaseTime = 0;
+		pxNewTCB->xNextInSlot = -1;
+	#endif /* schedUSE_RELEASE_ENGINE */
+
+	#if( schedUSE_WCET_CALIBRATION == 1 )
+		/* member initialization */
+		UBaseType_t uxBin;
+		for( uxBin = 0; uxBin < schedWCET_HISTOGRAM_BINS; uxBin++ )
+		{
+			pxNewTCB->usExecTimeHistogram[ uxBin ] = 0;
+		}
+		pxNewTCB->usCalibrationJobs = 0;
+		pxNewTCB->xObservedMaxExecTime = 0;
+	#endif /* schedUSE_WCET_CALIBRATION */
+
+	#if( schedUSE_MK_FIRM == 1 )
+		/* Hard deadlines until vSchedulerPeriodicTaskSetMKFirm is called. */
+		pxNewTCB->uxMKM = 0;
+		pxNewTCB->uxMKK = 0;
+		pxNewTCB->ulMKHistory = 0;
+	#endif /* schedUSE_MK_FIRM */
+
 	#if( schedUSE_TCB_ARRAY == 1 )
 		xTaskCounter++;	
 	#endif /* schedUSE_TCB_SORTED_LIST */
@@ -330,6 +879,90 @@ void vSchedulerPeriodicTaskDelete( TaskHandle_t xTaskHandle )
 	vTaskDelete( xTaskHandle );
 }
 
+#if( schedUSE_MK_FIRM == 1 )
+	/* Gives a periodic task an (m,k)-firm constraint. */
+	void vSchedulerPeriodicTaskSetMKFirm( TaskHandle_t *pxCreatedTask, UBaseType_t uxM, UBaseType_t uxK )
+	{
+		SchedTCB_t *pxTCB;
+
+		configASSERT( 0 < uxM && uxM <= uxK && uxK <= schedMK_MAX_K );
+
+		#if( schedUSE_TCB_ARRAY == 1 )
+			BaseType_t xIndex = prvGetTCBIndexFromHandlePointer( pxCreatedTask );
+			configASSERT( -1 != xIndex );
+			pxTCB = &xTCBArray[ xIndex ];
+		#endif /* schedUSE_TCB_ARRAY */
+
+		taskENTER_CRITICAL();
+		pxTCB->uxMKM = uxM;
+		pxTCB->uxMKK = uxK;
+		/* Start from a history in which every previous job met its deadline. */
+		pxTCB->ulMKHistory = prvMKMask( uxK );
+		taskEXIT_CRITICAL();
+	}
+#endif /* schedUSE_MK_FIRM */
+
+#if( schedUSE_ELASTIC_PERIODS == 1 )
+	/* Makes the period of a periodic task elastic. */
+	void vSchedulerPeriodicTaskSetElastic( TaskHandle_t *pxCreatedTask, TickType_t xMinPeriodTick, TickType_t xMaxPeriodTick, UBaseType_t uxElasticity )
+	{
+		SchedTCB_t *pxTCB;
+
+		configASSERT( 0 < xMinPeriodTick && xMinPeriodTick <= xMaxPeriodTick );
+
+		#if( schedUSE_TCB_ARRAY == 1 )
+			BaseType_t xIndex = prvGetTCBIndexFromHandlePointer( pxCreatedTask );
+			configASSERT( -1 != xIndex );
+			pxTCB = &xTCBArray[ xIndex ];
+		#endif /* schedUSE_TCB_ARRAY */
+
+		taskENTER_CRITICAL();
+		pxTCB->xMinPeriod = xMinPeriodTick;
+		pxTCB->xMaxPeriod = xMaxPeriodTick;
+		pxTCB->uxElasticity = uxElasticity;
+		pxTCB->xPeriod = xMinPeriodTick;
+		pxTCB->xPendingPeriod = xMinPeriodTick;
+		if( pdTRUE == pxTCB->xImplicitDeadline )
+		{
+			pxTCB->xRelativeDeadline = xMinPeriodTick;
+		}
+		taskEXIT_CRITICAL();
+	}
+#endif /* schedUSE_ELASTIC_PERIODS */
+
+/* Replaces worst-case execution times by task name, e.g. with a table printed
+ * by WCET calibration. */
+void vSchedulerPeriodicTaskSetBudgets( const SchedTaskBudget_t *pxBudgets, UBaseType_t uxBudgetCount )
+{
+	BaseType_t xIndex;
+	UBaseType_t uxBudget;
+	SchedTCB_t *pxTCB;
+
+	configASSERT( NULL != pxBudgets || 0 == uxBudgetCount );
+
+	#if( schedUSE_TCB_ARRAY == 1 )
+		for( xIndex = 0; xIndex < schedMAX_NUMBER_OF_PERIODIC_TASKS; xIndex++ )
+		{
+			pxTCB = &xTCBArray[ xIndex ];
+			if( pdFALSE == pxTCB->xInUse )
+			{
+				continue;
+			}
+			for( uxBudget = 0; uxBudget < uxBudgetCount; uxBudget++ )
+			{
+				if( 0 == strcmp( pxTCB->pcName, pxBudgets[ uxBudget ].pcName ) )
+				{
+					pxTCB->xMaxExecTime = pxBudgets[ uxBudget ].xMaxExecTimeTick;
+					#if( schedUSE_ELASTIC_PERIODS == 1 )
+						pxTCB->xMeasuredExecTime = pxBudgets[ uxBudget ].xMaxExecTimeTick;
+					#endif /* schedUSE_ELASTIC_PERIODS */
+					break;
+				}
+			}
+		}
+	#endif /* schedUSE_TCB_ARRAY */
+}
+
 /* Creates all periodic tasks stored in TCB array, or TCB list. */
 static void prvCreateAllTasks( void )
 {
@@ -394,10 +1027,11 @@ static void prvSetFixedPriorities( void )
 				}
 			#endif /* schedSCHEDULING_POLICY */
 		}
-		configASSERT( -1 <= xHighestPriority );
 		if( xPreviousShortest != xShortest )
 		{
-			xHighestPriority--;
+			/* Fails when there are more distinct periods than priority levels. */
+			configASSERT( schedRMS_PRIORITY_STEP <= xHighestPriority );
+			xHighestPriority -= schedRMS_PRIORITY_STEP;
 		}
 		
 		/* set highest priority to task with xShortest period (the highest priority is configMAX_PRIORITIES-1) */		
@@ -413,63 +1047,417 @@ static void prvSetFixedPriorities( void )
 #endif /* schedSCHEDULING_POLICY */
 
 
-#if( schedUSE_TIMING_ERROR_DETECTION_DEADLINE == 1 )
-
-	/* Recreates a deleted task that still has its information left in the task array (or list). */
-	static void prvPeriodicTaskRecreate( SchedTCB_t *pxTCB )
+#if( schedUSE_PREEMPTION_THRESHOLD == 1 || schedUSE_WCET_CALIBRATION == 1 )
+	/* Response-time analysis under preemption thresholds (Wang and Saksena).
+	 * Returns pdTRUE if every job of the task finishes within its relative deadline.
+	 * Tasks of equal priority are treated as able to preempt each other, since
+	 * FreeRTOS time slices between them. */
+	static BaseType_t prvTaskIsSchedulable( SchedTCB_t *pxTCB )
 	{
-		BaseType_t xReturnValue = xTaskCreate( /* your implementation goes here */prvPeriodicTaskCode, pxTCB->pcName, pxTCB->uxStackDepth, pxTCB->pvParameters, pxTCB->uxPriority, pxTCB->pxTaskHandle);
-				                      		
-		if( pdPASS == xReturnValue )
-		{
-			/* your implementation goes here */
-			//vTaskSetThreadLocalStoragePointer( *pxTCB->pxTaskHandle, schedTHREAD_LOCAL_STORAGE_POINTER_INDEX, ( SchedTCB_t * ) pxTCB );
+		SchedTCB_t *pxOther;
+		BaseType_t xIndex;
+		uint32_t ulC = pxTCB->xMaxExecTime, ulT = pxTCB->xPeriod, ulD = pxTCB->xRelativeDeadline;
+		uint32_t ulBlocking = 0, ulBusy, ulStart, ulFinish, ulNext, ulJob;
 
-			pxTCB->xExecutedOnce = pdFALSE;
-			#if( schedUSE_TIMING_ERROR_DETECTION_EXECUTION_TIME == 1 )
-				pxTCB->xSuspended = pdFALSE;
-				pxTCB->xMaxExecTimeExceeded = pdFALSE;
-			#endif
-		}
-		else
+		/* Blocking by one lower priority job whose threshold is at least our priority. */
+		for( xIndex = 0; xIndex < xTaskCounter; xIndex++ )
 		{
-			/* if task creation failed */
+			pxOther = &xTCBArray[ xIndex ];
+			if( pxOther->uxPriority < pxTCB->uxPriority && schedJOB_PRIORITY( pxOther ) >= pxTCB->uxPriority && pxOther->xMaxExecTime > ulBlocking )
+			{
+				ulBlocking = pxOther->xMaxExecTime;
+			}
 		}
-	}
-
-	/* Called when a deadline of a periodic task is missed.
-	 * Deletes the periodic task that has missed it's deadline and recreate it.
-	 * The periodic task is released during next period. */
-	static void prvDeadlineMissedHook( SchedTCB_t *pxTCB, TickType_t xTickCount )
-	{
-		//Serial.println( "\r\ndeadline missed! %s tick %d\r\n", pxTCB->pcName, xTickCount );
-
-		/* Delete the pxTask and recreate it. */
-		vTaskDelete( /* your implementation goes here */*pxTCB->pxTaskHandle );
-		pxTCB->xExecTime = 0;
-		prvPeriodicTaskRecreate( pxTCB );	
-		
-		/* Need to reset next WakeTime for correct release. */
-		/* your implementation goes here */
-		pxTCB->xReleaseTime = pxTCB->xLastWakeTime + pxTCB->xPeriod;
-		pxTCB->xLastWakeTime = 0;
-		pxTCB->xAbsoluteDeadline = pxTCB->xRelativeDeadline + pxTCB->xReleaseTime;
-	}
 
-	/* Checks whether given task has missed deadline or not. */
-	static void prvCheckDeadline( SchedTCB_t *pxTCB, TickType_t xTickCount )
-	{ 
-		/* check whether deadline is missed. */     		
-		/* your implementation goes here */
-		//prvDeadlineMissedHook( pxTCB, xTickCount );
-		if( ( NULL != pxTCB ) && ( pdFALSE == pxTCB->xWorkIsDone ) && ( pdTRUE == pxTCB->xExecutedOnce ) )
+		/* Length of the level-i busy period. prvTaskSetIsSchedulable has checked
+		 * that utilization does not exceed 1, so this converges. */
+		ulBusy = ulBlocking + ulC;
+		for( ; ; )
 		{
-			pxTCB->xAbsoluteDeadline = pxTCB->xLastWakeTime + pxTCB->xRelativeDeadline;
-			if( ( signed ) ( pxTCB->xAbsoluteDeadline - xTickCount ) < 0 )
+			ulNext = ulBlocking;
+			for( xIndex = 0; xIndex < xTaskCounter; xIndex++ )
 			{
-				prvDeadlineMissedHook( pxTCB, xTickCount );
+				pxOther = &xTCBArray[ xIndex ];
+				if( pxOther->uxPriority >= pxTCB->uxPriority )
+				{
+					ulNext += ( ( ulBusy + pxOther->xPeriod - 1 ) / pxOther->xPeriod ) * pxOther->xMaxExecTime;
+				}
 			}
-		}
+			if( ulNext == ulBusy )
+			{
+				break;
+			}
+			ulBusy = ulNext;
+		}
+
+		/* Check every job released within the busy period. */
+		for( ulJob = 0; ulJob * ulT < ulBusy; ulJob++ )
+		{
+			/* Latest start time: blocking, earlier jobs of the task, and every
+			 * release of other tasks with at least our priority until the start. */
+			ulStart = ulBlocking + ulJob * ulC;
+			for( ; ; )
+			{
+				ulNext = ulBlocking + ulJob * ulC;
+				for( xIndex = 0; xIndex < xTaskCounter; xIndex++ )
+				{
+					pxOther = &xTCBArray[ xIndex ];
+					if( pxOther != pxTCB && pxOther->uxPriority >= pxTCB->uxPriority )
+					{
+						ulNext += ( 1 + ulStart / pxOther->xPeriod ) * pxOther->xMaxExecTime;
+					}
+				}
+				if( ulNext == ulStart )
+				{
+					break;
+				}
+				ulStart = ulNext;
+			}
+
+			/* Finish time: once started, only tasks with a priority at or above the
+			 * threshold released after the start can preempt the job. */
+			ulFinish = ulStart + ulC;
+			for( ; ; )
+			{
+				ulNext = ulStart + ulC;
+				for( xIndex = 0; xIndex < xTaskCounter; xIndex++ )
+				{
+					pxOther = &xTCBArray[ xIndex ];
+					if( pxOther != pxTCB && pxOther->uxPriority >= schedJOB_PRIORITY( pxTCB ) )
+					{
+						ulNext += ( ( ulFinish + pxOther->xPeriod - 1 ) / pxOther->xPeriod - ( 1 + ulStart / pxOther->xPeriod ) ) * pxOther->xMaxExecTime;
+					}
+				}
+				if( ulNext <= ulFinish )
+				{
+					break;
+				}
+				ulFinish = ulNext;
+			}
+
+			if( ulFinish - ulJob * ulT > ulD )
+			{
+				return pdFALSE;
+			}
+		}
+
+		return pdTRUE;
+	}
+
+	/* Returns pdTRUE if all periodic tasks are schedulable with their current thresholds. */
+	static BaseType_t prvTaskSetIsSchedulable( void )
+	{
+		BaseType_t xIndex;
+		uint32_t ulUtilization = 0;
+
+		/* Utilization in parts per 10000, rounded up. */
+		for( xIndex = 0; xIndex < xTaskCounter; xIndex++ )
+		{
+			ulUtilization += schedUTILIZATION( xTCBArray[ xIndex ].xMaxExecTime, xTCBArray[ xIndex ].xPeriod );
+		}
+		if( ulUtilization > 10000UL )
+		{
+			return pdFALSE;
+		}
+
+		for( xIndex = 0; xIndex < xTaskCounter; xIndex++ )
+		{
+			if( pdFALSE == prvTaskIsSchedulable( &xTCBArray[ xIndex ] ) )
+			{
+				return pdFALSE;
+			}
+		}
+		return pdTRUE;
+	}
+#endif /* schedUSE_PREEMPTION_THRESHOLD || schedUSE_WCET_CALIBRATION */
+
+
+#if( schedUSE_PREEMPTION_THRESHOLD == 1 )
+	/* Returns pdTRUE if some periodic task has the given priority. */
+	static BaseType_t prvIsTaskPriority( UBaseType_t uxPriority )
+	{
+		BaseType_t xIndex;
+
+		for( xIndex = 0; xIndex < xTaskCounter; xIndex++ )
+		{
+			if( xTCBArray[ xIndex ].uxPriority == uxPriority )
+			{
+				return pdTRUE;
+			}
+		}
+		return pdFALSE;
+	}
+
+	/* Assigns preemption thresholds. Tasks are visited from highest to lowest
+	 * priority and each threshold is raised as long as the task set stays
+	 * schedulable. Levels used as a priority by another task are skipped: a
+	 * task released at the level of a running job preempts it on the tick and
+	 * then time slices with it, so such a threshold blocks nothing. If the task
+	 * set is not schedulable under plain RMS the thresholds are left equal to
+	 * the priorities. */
+	static void prvAssignPreemptionThresholds( void )
+	{
+		BaseType_t xIndex;
+		UBaseType_t uxMaxPriority = 0, uxPriority, uxCandidate, uxAccepted;
+		SchedTCB_t *pxTCB;
+
+		for( xIndex = 0; xIndex < xTaskCounter; xIndex++ )
+		{
+			pxTCB = &xTCBArray[ xIndex ];
+			pxTCB->uxPreemptionThreshold = pxTCB->uxPriority;
+			if( pxTCB->uxPriority > uxMaxPriority )
+			{
+				uxMaxPriority = pxTCB->uxPriority;
+			}
+		}
+
+		if( pdFALSE == prvTaskSetIsSchedulable() )
+		{
+			return;
+		}
+
+		for( uxPriority = uxMaxPriority + 1; uxPriority-- > 0; )
+		{
+			for( xIndex = 0; xIndex < xTaskCounter; xIndex++ )
+			{
+				pxTCB = &xTCBArray[ xIndex ];
+				if( pxTCB->uxPriority != uxPriority )
+				{
+					continue;
+				}
+				uxAccepted = pxTCB->uxPreemptionThreshold;
+				for( uxCandidate = uxAccepted + 1; uxCandidate < uxMaxPriority; uxCandidate++ )
+				{
+					if( pdTRUE == prvIsTaskPriority( uxCandidate ) )
+					{
+						continue;
+					}
+					pxTCB->uxPreemptionThreshold = uxCandidate;
+					if( pdFALSE == prvTaskSetIsSchedulable() )
+					{
+						break;
+					}
+					uxAccepted = uxCandidate;
+				}
+				pxTCB->uxPreemptionThreshold = uxAccepted;
+			}
+		}
+	}
+
+	/* Groups tasks that can never preempt each other. Two tasks are mutually
+	 * non-preemptive when each one's priority is below the other's threshold;
+	 * as in prvTaskIsSchedulable, equal priorities time slice and so interleave.
+	 * Tasks are placed greedily into the first compatible group. */
+	static void prvAssignStackGroups( void )
+	{
+		BaseType_t xIndex, xOther, xGroup, xGroupCount = 0;
+		SchedTCB_t *pxTCB, *pxOther;
+
+		for( xIndex = 0; xIndex < xTaskCounter; xIndex++ )
+		{
+			pxTCB = &xTCBArray[ xIndex ];
+			for( xGroup = 0; xGroup < xGroupCount; xGroup++ )
+			{
+				for( xOther = 0; xOther < xIndex; xOther++ )
+				{
+					pxOther = &xTCBArray[ xOther ];
+					if( pxOther->xStackGroup == xGroup &&
+						( pxTCB->uxPriority >= pxOther->uxPreemptionThreshold || pxOther->uxPriority >= pxTCB->uxPreemptionThreshold ) )
+					{
+						break;
+					}
+				}
+				if( xOther == xIndex )
+				{
+					break;
+				}
+			}
+			pxTCB->xStackGroup = xGroup;
+			if( xGroup == xGroupCount )
+			{
+				xGroupCount++;
+			}
+		}
+	}
+
+	#if( schedPRINT_PREEMPTION_THRESHOLD_REPORT == 1 || schedCONTEXT_SWITCH_STATS == 1 )
+		/* Least common multiple of all periods. */
+		static uint32_t prvHyperperiod( void )
+		{
+			BaseType_t xIndex;
+			uint32_t ulHyperperiod = 1, ulA, ulB, ulTemp;
+
+			for( xIndex = 0; xIndex < xTaskCounter; xIndex++ )
+			{
+				ulA = ulHyperperiod;
+				ulB = xTCBArray[ xIndex ].xPeriod;
+				while( 0 != ulB )
+				{
+					ulTemp = ulA % ulB;
+					ulA = ulB;
+					ulB = ulTemp;
+				}
+				ulHyperperiod = ( ulHyperperiod / ulA ) * xTCBArray[ xIndex ].xPeriod;
+			}
+			return ulHyperperiod;
+		}
+
+		/* Analytic upper bound on preemptions in one hyperperiod. Each job can be
+		 * preempted once by every release, before its deadline, of another task
+		 * with a priority at or above its threshold. Thresholds never equal the
+		 * priority of another task, so only tasks that share an RMS level (equal
+		 * periods) time slice, under both RMS and thresholds; those switches are
+		 * not counted. */
+		static uint32_t prvPreemptionBound( BaseType_t xUseThresholds )
+		{
+			BaseType_t xIndex, xOther;
+			uint32_t ulHyperperiod = prvHyperperiod(), ulPreemptions = 0, ulPerJob;
+			UBaseType_t uxThreshold;
+			SchedTCB_t *pxTCB, *pxOther;
+
+			for( xIndex = 0; xIndex < xTaskCounter; xIndex++ )
+			{
+				pxTCB = &xTCBArray[ xIndex ];
+				uxThreshold = ( pdTRUE == xUseThresholds ) ? pxTCB->uxPreemptionThreshold : pxTCB->uxPriority;
+				ulPerJob = 0;
+				for( xOther = 0; xOther < xTaskCounter; xOther++ )
+				{
+					pxOther = &xTCBArray[ xOther ];
+					if( pxOther != pxTCB && pxOther->uxPriority >= uxThreshold )
+					{
+						ulPerJob += ( pxTCB->xRelativeDeadline + pxOther->xPeriod - 1 ) / pxOther->xPeriod;
+					}
+				}
+				ulPreemptions += ( ulHyperperiod / pxTCB->xPeriod ) * ulPerJob;
+			}
+			return ulPreemptions;
+		}
+	#endif /* schedPRINT_PREEMPTION_THRESHOLD_REPORT || schedCONTEXT_SWITCH_STATS */
+
+	#if( schedPRINT_PREEMPTION_THRESHOLD_REPORT == 1 )
+		/* Prints thresholds, stack groups, and the context switch figures of plain
+		 * RMS against preemption thresholds. The shared stack figure is what a
+		 * run-to-completion design could reach; FreeRTOS tasks here keep their own
+		 * stacks, because a blocked task keeps its context on its stack. */
+		static void prvPrintPreemptionThresholdReport( void )
+		{
+			BaseType_t xIndex, xGroup;
+			uint32_t ulDedicated = 0, ulShared = 0, ulGroupMax;
+
+			for( xIndex = 0; xIndex < xTaskCounter; xIndex++ )
+			{
+				Serial.print( xTCBArray[ xIndex ].pcName );
+				Serial.print( " priority " );
+				Serial.print( xTCBArray[ xIndex ].uxPriority );
+				Serial.print( " threshold " );
+				Serial.print( xTCBArray[ xIndex ].uxPreemptionThreshold );
+				Serial.print( " stack group " );
+				Serial.println( xTCBArray[ xIndex ].xStackGroup );
+				ulDedicated += xTCBArray[ xIndex ].uxStackDepth;
+			}
+
+			for( xGroup = 0; xGroup < xTaskCounter; xGroup++ )
+			{
+				ulGroupMax = 0;
+				for( xIndex = 0; xIndex < xTaskCounter; xIndex++ )
+				{
+					if( xTCBArray[ xIndex ].xStackGroup == xGroup && xTCBArray[ xIndex ].uxStackDepth > ulGroupMax )
+					{
+						ulGroupMax = xTCBArray[ xIndex ].uxStackDepth;
+					}
+				}
+				ulShared += ulGroupMax;
+			}
+
+			/* Every preemption costs two context switches. */
+			Serial.print( "Context switches per hyperperiod (analytic bound): RMS " );
+			Serial.print( 2 * prvPreemptionBound( pdFALSE ) );
+			Serial.print( ", threshold " );
+			Serial.println( 2 * prvPreemptionBound( pdTRUE ) );
+			Serial.print( "Stack words: dedicated " );
+			Serial.print( ulDedicated );
+			Serial.print( ", shared per group (hypothetical lower bound, run-to-completion only) " );
+			Serial.println( ulShared );
+			Serial.flush();
+		}
+	#endif /* schedPRINT_PREEMPTION_THRESHOLD_REPORT */
+#endif /* schedUSE_PREEMPTION_THRESHOLD */
+
+
+#if( schedUSE_TIMING_ERROR_DETECTION_DEADLINE == 1 )
+
+	/* Recreates a deleted task that still has its information left in the task array (or list). */
+	static void prvPeriodicTaskRecreate( SchedTCB_t *pxTCB )
+	{
+		BaseType_t xReturnValue = xTaskCreate( /* your implementation goes here */prvPeriodicTaskCode, pxTCB->pcName, pxTCB->uxStackDepth, pxTCB->pvParameters, pxTCB->uxPriority, pxTCB->pxTaskHandle);
+				                      		
+		if( pdPASS == xReturnValue )
+		{
+			/* your implementation goes here */
+			//vTaskSetThreadLocalStoragePointer( *pxTCB->pxTaskHandle, schedTHREAD_LOCAL_STORAGE_POINTER_INDEX, ( SchedTCB_t * ) pxTCB );
+
+			pxTCB->xExecutedOnce = pdFALSE;
+			#if( schedUSE_TIMING_ERROR_DETECTION_EXECUTION_TIME == 1 )
+				pxTCB->xSuspended = pdFALSE;
+				pxTCB->xMaxExecTimeExceeded = pdFALSE;
+			#endif
+		}
+		else
+		{
+			/* if task creation failed */
+		}
+	}
+
+	/* Called when a deadline of a periodic task is missed.
+	 * Deletes the periodic task that has missed it's deadline and recreate it.
+	 * The periodic task is released during next period. */
+	static void prvDeadlineMissedHook( SchedTCB_t *pxTCB, TickType_t xTickCount )
+	{
+		//Serial.println( "\r\ndeadline missed! %s tick %d\r\n", pxTCB->pcName, xTickCount );
+
+		#if( schedUSE_RELEASE_ENGINE == 1 )
+			/* No releases to the task while it is being replaced. */
+			BaseType_t xIndex = pxTCB - xTCBArray;
+			taskENTER_CRITICAL();
+			prvReleaseEngineRemove( xIndex );
+			taskEXIT_CRITICAL();
+		#endif /* schedUSE_RELEASE_ENGINE */
+
+		/* Delete the pxTask and recreate it. */
+		vTaskDelete( /* your implementation goes here */*pxTCB->pxTaskHandle );
+		pxTCB->xExecTime = 0;
+
+		prvPeriodicTaskRecreate( pxTCB );	
+		
+		#if( schedUSE_RELEASE_ENGINE == 1 )
+			/* The release time is kept, so the new task is released on the original schedule. */
+			taskENTER_CRITICAL();
+			prvReleaseEngineInsert( xIndex );
+			taskEXIT_CRITICAL();
+			pxTCB->xAbsoluteDeadline = pxTCB->xRelativeDeadline + pxTCB->xNextReleaseTime;
+		#else
+			/* Need to reset next WakeTime for correct release. */
+			/* your implementation goes here */
+			pxTCB->xReleaseTime = pxTCB->xLastWakeTime + pxTCB->xPeriod;
+			pxTCB->xLastWakeTime = 0;
+			pxTCB->xAbsoluteDeadline = pxTCB->xRelativeDeadline + pxTCB->xReleaseTime;
+		#endif /* schedUSE_RELEASE_ENGINE */
+	}
+
+	/* Checks whether given task has missed deadline or not. */
+	static void prvCheckDeadline( SchedTCB_t *pxTCB, TickType_t xTickCount )
+	{ 
+		/* check whether deadline is missed. */     		
+		/* your implementation goes here */
+		//prvDeadlineMissedHook( pxTCB, xTickCount );
+		if( ( NULL != pxTCB ) && ( pdFALSE == pxTCB->xWorkIsDone ) && ( pdTRUE == pxTCB->xExecutedOnce ) )
+		{
+			pxTCB->xAbsoluteDeadline = pxTCB->xLastWakeTime + pxTCB->xRelativeDeadline;
+			if( ( signed ) ( pxTCB->xAbsoluteDeadline - xTickCount ) < 0 )
+			{
+				prvDeadlineMissedHook( pxTCB, xTickCount );
+			}
+		}
 
     /*Serial.println("Absolute deadline"); //Release time of the task. 
     Serial.println(pxTCB->xAbsoluteDeadline); //Absolute deadline of the task. 
@@ -484,7 +1472,7 @@ static void prvSetFixedPriorities( void )
 #endif /* schedUSE_TIMING_ERROR_DETECTION_DEADLINE */
 
 
-#if( schedUSE_TIMING_ERROR_DETECTION_EXECUTION_TIME == 1 )
+#if( schedUSE_TIMING_ERROR_DETECTION_EXECUTION_TIME == 1 && schedUSE_WCET_CALIBRATION == 0 )
 
 	/* Called if a periodic task has exceeded it's worst-case execution time.
 	 * The periodic task is blocked until next period. A context switch to
@@ -504,7 +1492,301 @@ static void prvSetFixedPriorities( void )
 		xTaskResumeFromISR(xSchedulerHandle);
     //xTaskResumeFromISR(xHigherPriorityTaskWoken);        
 	}
-#endif /* schedUSE_TIMING_ERROR_DETECTION_EXECUTION_TIME */
+#endif /* schedUSE_TIMING_ERROR_DETECTION_EXECUTION_TIME && !schedUSE_WCET_CALIBRATION */
+
+
+#if( schedUSE_ELASTIC_PERIODS == 1 )
+	/* Liu and Layland bound n(2^(1/n) - 1) in parts per 10000. */
+	static uint32_t prvRMSUtilizationBound( BaseType_t xTaskCount )
+	{
+		static const uint16_t usBounds[] = { 10000, 10000, 8284, 7798, 7568, 7435, 7348, 7286, 7241, 7205, 7177 };
+
+		if( xTaskCount < ( BaseType_t ) ( sizeof( usBounds ) / sizeof( usBounds[ 0 ] ) ) )
+		{
+			return usBounds[ xTaskCount ];
+		}
+		/* Limit for large n is ln 2. */
+		return 6931;
+	}
+
+	/* Elastic task model (Buttazzo et al.). Called by the scheduler task.
+	 * Utilizations are computed from execution times measured in the tick hook.
+	 * If the nominal utilization exceeds the RMS bound, elastic tasks are
+	 * compressed in proportion to their elasticity until the bound is met. A
+	 * task that reaches its longest period is fixed there and the remaining
+	 * excess is spread over the other tasks. Priorities are not changed, so the
+	 * longest period of a task is also limited to the minimum period of every
+	 * task with a lower priority. Periods then stay in the RMS order of the
+	 * priorities and the Liu and Layland bound remains valid. Utilizations are
+	 * rounded up. New periods take effect at the next job boundary. */
+	static void prvElasticAdaptPeriods( void )
+	{
+		BaseType_t xIndex, xOther, xChanged;
+		BaseType_t xSaturated[ schedMAX_NUMBER_OF_PERIODIC_TASKS ];
+		int32_t lUtilization[ schedMAX_NUMBER_OF_PERIODIC_TASKS ];
+		TickType_t xLongestPeriod[ schedMAX_NUMBER_OF_PERIODIC_TASKS ];
+		uint32_t ulBound = prvRMSUtilizationBound( xTaskCounter );
+		uint32_t ulFixed, ulFlexible, ulElasticSum, ulExcess, ulMin, ulPeriod;
+		SchedTCB_t *pxTCB;
+
+		for( xIndex = 0; xIndex < xTaskCounter; xIndex++ )
+		{
+			pxTCB = &xTCBArray[ xIndex ];
+			xLongestPeriod[ xIndex ] = ( 0 == pxTCB->uxElasticity ) ? pxTCB->xMinPeriod : pxTCB->xMaxPeriod;
+			for( xOther = 0; xOther < xTaskCounter; xOther++ )
+			{
+				if( xTCBArray[ xOther ].uxPriority < pxTCB->uxPriority && xTCBArray[ xOther ].xMinPeriod < xLongestPeriod[ xIndex ] )
+				{
+					xLongestPeriod[ xIndex ] = xTCBArray[ xOther ].xMinPeriod;
+				}
+			}
+			if( xLongestPeriod[ xIndex ] < pxTCB->xMinPeriod )
+			{
+				xLongestPeriod[ xIndex ] = pxTCB->xMinPeriod;
+			}
+
+			taskENTER_CRITICAL();
+			if( 0 != pxTCB->xWindowExecTime )
+			{
+				pxTCB->xMeasuredExecTime = pxTCB->xWindowExecTime;
+				pxTCB->xWindowExecTime = 0;
+			}
+			taskEXIT_CRITICAL();
+			xSaturated[ xIndex ] = ( xLongestPeriod[ xIndex ] == pxTCB->xMinPeriod ) ? pdTRUE : pdFALSE;
+		}
+
+		do
+		{
+			xChanged = pdFALSE;
+			ulFixed = 0;
+			ulFlexible = 0;
+			ulElasticSum = 0;
+
+			/* Saturated tasks run at their longest period, which is the minimum for inelastic ones. */
+			for( xIndex = 0; xIndex < xTaskCounter; xIndex++ )
+			{
+				pxTCB = &xTCBArray[ xIndex ];
+				if( pdTRUE == xSaturated[ xIndex ] )
+				{
+					ulFixed += schedUTILIZATION( pxTCB->xMeasuredExecTime, xLongestPeriod[ xIndex ] );
+				}
+				else
+				{
+					ulFlexible += schedUTILIZATION( pxTCB->xMeasuredExecTime, pxTCB->xMinPeriod );
+					ulElasticSum += pxTCB->uxElasticity;
+				}
+			}
+
+			if( ulFixed + ulFlexible <= ulBound )
+			{
+				/* No compression needed. */
+				ulExcess = 0;
+			}
+			else if( 0 == ulElasticSum || ulFixed >= ulBound )
+			{
+				/* Overload cannot be absorbed. Stretch every elastic task to its longest period. */
+				for( xIndex = 0; xIndex < xTaskCounter; xIndex++ )
+				{
+					xSaturated[ xIndex ] = pdTRUE;
+				}
+				break;
+			}
+			else
+			{
+				ulExcess = ulFixed + ulFlexible - ulBound;
+			}
+
+			for( xIndex = 0; xIndex < xTaskCounter; xIndex++ )
+			{
+				pxTCB = &xTCBArray[ xIndex ];
+				if( pdTRUE == xSaturated[ xIndex ] )
+				{
+					continue;
+				}
+				/* The share of the excess is rounded up, so the shares cover all of it. */
+				lUtilization[ xIndex ] = ( int32_t ) schedUTILIZATION( pxTCB->xMeasuredExecTime, pxTCB->xMinPeriod )
+						- ( int32_t ) ( ( ulExcess * pxTCB->uxElasticity + ulElasticSum - 1 ) / ulElasticSum );
+				ulMin = schedUTILIZATION( pxTCB->xMeasuredExecTime, xLongestPeriod[ xIndex ] );
+				if( lUtilization[ xIndex ] <= ( int32_t ) ulMin )
+				{
+					xSaturated[ xIndex ] = pdTRUE;
+					xChanged = pdTRUE;
+				}
+			}
+		} while( pdTRUE == xChanged );
+
+		for( xIndex = 0; xIndex < xTaskCounter; xIndex++ )
+		{
+			pxTCB = &xTCBArray[ xIndex ];
+			if( 0 == pxTCB->uxElasticity )
+			{
+				continue;
+			}
+
+			if( 0 == pxTCB->xMeasuredExecTime || ( pdFALSE == xSaturated[ xIndex ] && 0 == ulExcess ) )
+			{
+				ulPeriod = pxTCB->xMinPeriod;
+			}
+			else if( pdTRUE == xSaturated[ xIndex ] )
+			{
+				ulPeriod = xLongestPeriod[ xIndex ];
+			}
+			else
+			{
+				/* T = C / U, rounded up so the utilization stays below the target. */
+				ulPeriod = ( ( uint32_t ) pxTCB->xMeasuredExecTime * 10000UL + lUtilization[ xIndex ] - 1 ) / lUtilization[ xIndex ];
+				if( ulPeriod < pxTCB->xMinPeriod )
+				{
+					ulPeriod = pxTCB->xMinPeriod;
+				}
+				else if( ulPeriod > xLongestPeriod[ xIndex ] )
+				{
+					ulPeriod = xLongestPeriod[ xIndex ];
+				}
+			}
+
+			taskENTER_CRITICAL();
+			pxTCB->xPendingPeriod = ( TickType_t ) ulPeriod;
+			taskEXIT_CRITICAL();
+		}
+	}
+#endif /* schedUSE_ELASTIC_PERIODS */
+
+
+#if( schedUSE_WCET_CALIBRATION == 1 )
+	/* Adds the execution time of the finished job to the task histogram. */
+	static void prvCalibrationRecordJob( SchedTCB_t *pxTCB )
+	{
+		TickType_t xExecTime = pxTCB->xExecTime;
+		TickType_t xBin = xExecTime / schedWCET_HISTOGRAM_BIN_TICKS;
+
+		if( pxTCB->usCalibrationJobs >= schedWCET_CALIBRATION_WINDOW )
+		{
+			return;
+		}
+
+		/* Clamp before narrowing, UBaseType_t may be narrower than TickType_t. */
+		if( xBin >= schedWCET_HISTOGRAM_BINS )
+		{
+			xBin = schedWCET_HISTOGRAM_BINS - 1;
+		}
+		pxTCB->usExecTimeHistogram[ ( UBaseType_t ) xBin ]++;
+		if( xExecTime > pxTCB->xObservedMaxExecTime )
+		{
+			pxTCB->xObservedMaxExecTime = xExecTime;
+		}
+		pxTCB->usCalibrationJobs++;
+	}
+
+	/* Returns the upper edge of the bin holding the given percentile, which is
+	 * never below the percentile itself and never above the observed maximum. */
+	static TickType_t prvCalibrationPercentile( SchedTCB_t *pxTCB, UBaseType_t uxPercent )
+	{
+		uint32_t ulRank = ( ( uint32_t ) pxTCB->usCalibrationJobs * uxPercent + 99 ) / 100;
+		uint32_t ulCount = 0;
+		TickType_t xValue;
+		UBaseType_t uxBin;
+
+		for( uxBin = 0; uxBin < schedWCET_HISTOGRAM_BINS - 1; uxBin++ )
+		{
+			ulCount += pxTCB->usExecTimeHistogram[ uxBin ];
+			if( ulCount >= ulRank )
+			{
+				xValue = ( uxBin + 1 ) * schedWCET_HISTOGRAM_BIN_TICKS - 1;
+				return ( xValue < pxTCB->xObservedMaxExecTime ) ? xValue : pxTCB->xObservedMaxExecTime;
+			}
+		}
+		return pxTCB->xObservedMaxExecTime;
+	}
+
+	/* Learned budget: observed maximum plus schedWCET_MARGIN_PERCENT, at least one tick. */
+	static TickType_t prvCalibrationBudget( SchedTCB_t *pxTCB )
+	{
+		uint32_t ulBudget = pxTCB->xObservedMaxExecTime + ( ( uint32_t ) pxTCB->xObservedMaxExecTime * schedWCET_MARGIN_PERCENT + 99 ) / 100;
+
+		return ( 0 == ulBudget ) ? 1 : ( TickType_t ) ulBudget;
+	}
+
+	/* Called by the scheduler task. Once every task has filled its window, prints
+	 * the learned budgets as a SchedTaskBudget_t table and reruns the
+	 * schedulability analysis with them in place of the hand-entered ones. */
+	static void prvCalibrationCheckDone( void )
+	{
+		static BaseType_t xReported = pdFALSE;
+		TickType_t xGivenExecTime[ schedMAX_NUMBER_OF_PERIODIC_TASKS ];
+		uint32_t ulUtilization = 0;
+		BaseType_t xIndex, xSchedulable;
+		SchedTCB_t *pxTCB;
+
+		if( pdTRUE == xReported )
+		{
+			return;
+		}
+		for( xIndex = 0; xIndex < xTaskCounter; xIndex++ )
+		{
+			if( xTCBArray[ xIndex ].usCalibrationJobs < schedWCET_CALIBRATION_WINDOW )
+			{
+				return;
+			}
+		}
+		xReported = pdTRUE;
+
+		Serial.println( "WCET calibration (ticks):" );
+		for( xIndex = 0; xIndex < xTaskCounter; xIndex++ )
+		{
+			pxTCB = &xTCBArray[ xIndex ];
+			Serial.print( pxTCB->pcName );
+			Serial.print( " max " );
+			Serial.print( pxTCB->xObservedMaxExecTime );
+			Serial.print( " p" );
+			Serial.print( schedWCET_PERCENTILE_LOW );
+			Serial.print( " " );
+			Serial.print( prvCalibrationPercentile( pxTCB, schedWCET_PERCENTILE_LOW ) );
+			Serial.print( " p" );
+			Serial.print( schedWCET_PERCENTILE_HIGH );
+			Serial.print( " " );
+			Serial.print( prvCalibrationPercentile( pxTCB, schedWCET_PERCENTILE_HIGH ) );
+			Serial.print( " given " );
+			Serial.print( pxTCB->xMaxExecTime );
+			Serial.print( " learned " );
+			Serial.println( prvCalibrationBudget( pxTCB ) );
+		}
+
+		/* Swap in the learned budgets for the analysis. Enforcement is off in
+		 * calibration mode, so xMaxExecTime is not used by the tick hook. */
+		for( xIndex = 0; xIndex < xTaskCounter; xIndex++ )
+		{
+			pxTCB = &xTCBArray[ xIndex ];
+			xGivenExecTime[ xIndex ] = pxTCB->xMaxExecTime;
+			pxTCB->xMaxExecTime = prvCalibrationBudget( pxTCB );
+			ulUtilization += schedUTILIZATION( pxTCB->xMaxExecTime, pxTCB->xPeriod );
+		}
+		xSchedulable = prvTaskSetIsSchedulable();
+		for( xIndex = 0; xIndex < xTaskCounter; xIndex++ )
+		{
+			xTCBArray[ xIndex ].xMaxExecTime = xGivenExecTime[ xIndex ];
+		}
+
+		/* Ready to paste into the sketch and pass to vSchedulerPeriodicTaskSetBudgets. */
+		Serial.println( "const SchedTaskBudget_t xBudgets[] = {" );
+		for( xIndex = 0; xIndex < xTaskCounter; xIndex++ )
+		{
+			pxTCB = &xTCBArray[ xIndex ];
+			Serial.print( "\t{ \"" );
+			Serial.print( pxTCB->pcName );
+			Serial.print( "\", " );
+			Serial.print( prvCalibrationBudget( pxTCB ) );
+			Serial.println( " }," );
+		}
+		Serial.println( "};" );
+
+		Serial.print( "Utilization with learned budgets (per 10000, rounded up): " );
+		Serial.println( ulUtilization );
+		Serial.print( "Schedulable with learned budgets: " );
+		Serial.println( ( pdTRUE == xSchedulable ) ? "yes" : "no" );
+		Serial.flush();
+	}
+#endif /* schedUSE_WCET_CALIBRATION */
 
 
 #if( schedUSE_SCHEDULER_TASK == 1 )
@@ -543,7 +1825,9 @@ static void prvSetFixedPriorities( void )
 				if( ( signed ) ( pxTCB->xAbsoluteUnblockTime - xTickCount ) <= 0 )
 				{
 					pxTCB->xSuspended = pdFALSE;
-					pxTCB->xLastWakeTime = xTickCount;
+					#if( schedUSE_RELEASE_ENGINE == 0 )
+						pxTCB->xLastWakeTime = xTickCount;
+					#endif /* schedUSE_RELEASE_ENGINE */
 					vTaskResume( *pxTCB->pxTaskHandle );
 				}
 			}		
@@ -555,10 +1839,30 @@ static void prvSetFixedPriorities( void )
 	/* Function code for the scheduler task. */
 	static void prvSchedulerFunction( void *pvParameters )
 	{
-
+		#if( schedUSE_ELASTIC_PERIODS == 1 )
+			UBaseType_t uxAdaptationCounter = 0;
+		#endif /* schedUSE_ELASTIC_PERIODS */
     
 		for( ; ; )
 		{ 
+			#if( schedUSE_ELASTIC_PERIODS == 1 )
+				uxAdaptationCounter++;
+				if( schedELASTIC_ADAPTATION_INTERVAL <= uxAdaptationCounter )
+				{
+					uxAdaptationCounter = 0;
+					prvElasticAdaptPeriods();
+				}
+			#endif /* schedUSE_ELASTIC_PERIODS */
+
+			#if( schedUSE_WCET_CALIBRATION == 1 )
+				prvCalibrationCheckDone();
+			#endif /* schedUSE_WCET_CALIBRATION */
+
+			#if( schedUSE_MK_FIRM == 1 )
+				prvMKCheckOverrun( xTaskGetTickCount() );
+			#endif /* schedUSE_MK_FIRM */
+
+
      		#if( schedUSE_TIMING_ERROR_DETECTION_DEADLINE == 1 || schedUSE_TIMING_ERROR_DETECTION_EXECUTION_TIME == 1 )
 				TickType_t xTickCount = xTaskGetTickCount();
         		SchedTCB_t *pxTCB;
@@ -607,22 +1911,52 @@ static void prvSetFixedPriorities( void )
 		TaskHandle_t xCurrentTaskHandle = xTaskGetCurrentTaskHandle();		
 		BaseType_t xIndex;
     
-		/* your implementation goes here. */
-        Serial.println("begin");
+		#if( schedTICK_COST_STATS == 1 )
+			if( pdFALSE == xTickStartTraced )
+			{
+				ulTickStartMicros = micros();
+			}
+		#endif /* schedTICK_COST_STATS */
+
+		#if( schedCONTEXT_SWITCH_STATS == 1 )
+			if( xCurrentTaskHandle != xLastSampledTask )
+			{
+				if( NULL != xLastSampledTask )
+				{
+					ulSampledSwitches++;
+					xIndex = prvGetTCBIndexFromHandle( xLastSampledTask );
+					if( xIndex >= 0 && pdFALSE == xTCBArray[ xIndex ].xWorkIsDone )
+					{
+						/* The job left the processor before completing. */
+						ulSampledPreemptions++;
+					}
+				}
+				xLastSampledTask = xCurrentTaskHandle;
+			}
+		#endif /* schedCONTEXT_SWITCH_STATS */
 
 		
 		xIndex = prvGetTCBIndexFromHandle(xCurrentTaskHandle);
-		pxCurrentTask = &xTCBArray[ xIndex ];
+		/* Tasks not created by this module, such as the idle task, have no extended TCB. */
+		pxCurrentTask = ( xIndex >= 0 ) ? &xTCBArray[ xIndex ] : NULL;
     
 		//( SchedTCB_t * ) pvTaskGetThreadLocalStoragePointer( xCurrentTaskHandle, schedTHREAD_LOCAL_STORAGE_POINTER_INDEX );
 		
 		if( xCurrentTaskHandle != xSchedulerHandle && xCurrentTaskHandle != xTaskGetIdleTaskHandle() && NULL != pxCurrentTask) /* what else needs to be checked ? */
 		{
 			pxCurrentTask->xExecTime++;     
+
+			#if( schedUSE_ELASTIC_PERIODS == 1 )
+				if( pxCurrentTask->xExecTime > pxCurrentTask->xWindowExecTime )
+				{
+					pxCurrentTask->xWindowExecTime = pxCurrentTask->xExecTime;
+				}
+			#endif /* schedUSE_ELASTIC_PERIODS */
      
-			#if( schedUSE_TIMING_ERROR_DETECTION_EXECUTION_TIME == 1 )
+			/* Budgets are not enforced while they are being calibrated. */
+			#if( schedUSE_TIMING_ERROR_DETECTION_EXECUTION_TIME == 1 && schedUSE_WCET_CALIBRATION == 0 )
 				/* your implementation goes here. */
-				if( pxCurrentTask->xMaxExecTime <= pxCurrentTask->xExecTime )
+				if( schedEXEC_TIME_IS_ENFORCED( pxCurrentTask ) && pxCurrentTask->xMaxExecTime <= pxCurrentTask->xExecTime )
 				{
 					if( pdFALSE == pxCurrentTask->xMaxExecTimeExceeded )
 					{
@@ -632,26 +1966,123 @@ static void prvSetFixedPriorities( void )
 						}
 					}
 				}
-			#endif /* schedUSE_TIMING_ERROR_DETECTION_EXECUTION_TIME */
+			#endif /* schedUSE_TIMING_ERROR_DETECTION_EXECUTION_TIME && !schedUSE_WCET_CALIBRATION */
 		}
 
-		#if( schedUSE_TIMING_ERROR_DETECTION_DEADLINE == 1 )    
+		#if( schedUSE_TIMING_ERROR_DETECTION_DEADLINE == 1 || schedUSE_ELASTIC_PERIODS == 1 || schedUSE_WCET_CALIBRATION == 1 || schedUSE_MK_FIRM == 1 )    
 			xSchedulerWakeCounter++;      
 			if( xSchedulerWakeCounter == schedSCHEDULER_TASK_PERIOD )
 			{
 				xSchedulerWakeCounter = 0;        
 				prvWakeScheduler();
 			}
-		#endif /* schedUSE_TIMING_ERROR_DETECTION_DEADLINE */
+		#endif /* schedUSE_TIMING_ERROR_DETECTION_DEADLINE || schedUSE_ELASTIC_PERIODS || schedUSE_WCET_CALIBRATION || schedUSE_MK_FIRM */
+
+		#if( schedUSE_RELEASE_ENGINE == 1 )
+			prvReleaseEngineTick( xTaskGetTickCountFromISR() );
+		#endif /* schedUSE_RELEASE_ENGINE */
+
+		#if( schedTICK_COST_STATS == 1 )
+		{
+			uint32_t ulElapsed = micros() - ulTickStartMicros;
+
+			ulTickCostTicks++;
+			ulTickCostMicros += ulElapsed;
+			if( ulElapsed > ulTickCostMaxMicros )
+			{
+				ulTickCostMaxMicros = ulElapsed;
+			}
+		}
+		#endif /* schedTICK_COST_STATS */
 	}
 #endif /* schedUSE_SCHEDULER_TASK */
 
+#if( schedTICK_COST_STATS == 1 )
+	/* Marks the start of tick processing. Called from traceTASK_INCREMENT_TICK. */
+	void vSchedulerTraceTickStart( void )
+	{
+		ulTickStartMicros = micros();
+		xTickStartTraced = pdTRUE;
+	}
+
+	/* Prints the number of released jobs and the time spent in tick processing. */
+	void vSchedulerPrintTickCostStats( void )
+	{
+		uint32_t ulReleases, ulTicks, ulMicros, ulMaxMicros;
+
+		taskENTER_CRITICAL();
+		ulReleases = ulJobReleaseCount;
+		ulTicks = ulTickCostTicks;
+		ulMicros = ulTickCostMicros;
+		ulMaxMicros = ulTickCostMaxMicros;
+		taskEXIT_CRITICAL();
+
+		#if( schedUSE_RELEASE_ENGINE == 1 )
+			Serial.print( "Release engine: " );
+		#else
+			Serial.print( "vTaskDelayUntil: " );
+		#endif /* schedUSE_RELEASE_ENGINE */
+		Serial.print( ulReleases );
+		Serial.print( " jobs released in " );
+		Serial.print( ulTicks );
+		Serial.println( " ticks" );
+		Serial.print( xTickStartTraced == pdTRUE ? "Tick us (from traceTASK_INCREMENT_TICK): total " : "Tick us (tick hook only): total " );
+		Serial.print( ulMicros );
+		Serial.print( ", max " );
+		Serial.println( ulMaxMicros );
+		Serial.flush();
+	}
+#endif /* schedTICK_COST_STATS */
+
+#if( schedCONTEXT_SWITCH_STATS == 1 )
+	/* Prints sampled context switch counts, and the analytic bound for the same time. */
+	void vSchedulerPrintContextSwitchStats( void )
+	{
+		uint32_t ulSwitches, ulPreemptions, ulTicks;
+
+		taskENTER_CRITICAL();
+		ulSwitches = ulSampledSwitches;
+		ulPreemptions = ulSampledPreemptions;
+		taskEXIT_CRITICAL();
+		ulTicks = ( uint32_t ) ( TickType_t ) ( xTaskGetTickCount() - xSystemStartTime );
+
+		Serial.print( "Context switches (sampled): " );
+		Serial.print( ulSwitches );
+		Serial.print( ", preempted jobs (sampled): " );
+		Serial.print( ulPreemptions );
+		Serial.print( " in " );
+		Serial.print( ulTicks );
+		Serial.println( " ticks" );
+
+		#if( schedUSE_PREEMPTION_THRESHOLD == 1 )
+		{
+			uint32_t ulHyperperiod = prvHyperperiod();
+			uint32_t ulRMS = prvPreemptionBound( pdFALSE ), ulThreshold = prvPreemptionBound( pdTRUE );
+
+			Serial.print( "Preempted jobs (analytic bound): RMS " );
+			Serial.print( ( ulTicks / ulHyperperiod ) * ulRMS + ( ulTicks % ulHyperperiod ) * ulRMS / ulHyperperiod );
+			Serial.print( ", threshold " );
+			Serial.println( ( ulTicks / ulHyperperiod ) * ulThreshold + ( ulTicks % ulHyperperiod ) * ulThreshold / ulHyperperiod );
+		}
+		#endif /* schedUSE_PREEMPTION_THRESHOLD */
+		Serial.flush();
+	}
+#endif /* schedCONTEXT_SWITCH_STATS */
+
 /* This function must be called before any other function call from this module. */
 void vSchedulerInit( void )
 {
 	#if( schedUSE_TCB_ARRAY == 1 )
 		prvInitTCBArray();
 	#endif /* schedUSE_TCB_ARRAY */
+
+	#if( schedUSE_RELEASE_ENGINE == 1 )
+		BaseType_t xSlot;
+		for( xSlot = 0; xSlot < schedRELEASE_WHEEL_SIZE; xSlot++ )
+		{
+			xReleaseWheel[ xSlot ] = -1;
+		}
+	#endif /* schedUSE_RELEASE_ENGINE */
 }
 
 /* Starts scheduling tasks. All periodic tasks (including polling server) must
@@ -662,6 +2093,14 @@ void vSchedulerStart( void )
 		prvSetFixedPriorities();	
 	#endif /* schedSCHEDULING_POLICY */
 
+	#if( schedUSE_PREEMPTION_THRESHOLD == 1 )
+		prvAssignPreemptionThresholds();
+		prvAssignStackGroups();
+		#if( schedPRINT_PREEMPTION_THRESHOLD_REPORT == 1 )
+			prvPrintPreemptionThresholdReport();
+		#endif /* schedPRINT_PREEMPTION_THRESHOLD_REPORT */
+	#endif /* schedUSE_PREEMPTION_THRESHOLD */
+
 	#if( schedUSE_SCHEDULER_TASK == 1 )
 		prvCreateSchedulerTask();
 	#endif /* schedUSE_SCHEDULER_TASK */
@@ -670,6 +2109,10 @@ void vSchedulerStart( void )
 	  
 	xSystemStartTime = xTaskGetTickCount();
 
+	#if( schedUSE_RELEASE_ENGINE == 1 )
+		prvReleaseEngineStart();
+	#endif /* schedUSE_RELEASE_ENGINE */
+
 	vTaskStartScheduler();
   
 }
@@ -33,9 +33,24 @@ extern "C" {
 /* Configure scheduling policy by setting this define to the appropriate one. */
 #define schedSCHEDULING_POLICY schedSCHEDULING_POLICY_RMS //schedSCHEDULING_POLICY_EDF
 
+/* Set this define to 1 to count released jobs and measure the time spent in
+ * tick processing, in both release modes (see schedUSE_RELEASE_ENGINE). The
+ * measurement starts in vSchedulerTraceTickStart if FreeRTOSConfig.h has
+ *     extern void vSchedulerTraceTickStart( void );
+ *     #define traceTASK_INCREMENT_TICK( xTickCount ) vSchedulerTraceTickStart()
+ * and then covers the kernel's delayed task list processing. Otherwise it starts in
+ * the tick hook. It ends at the end of the tick hook. Read the figures with
+ * vSchedulerPrintTickCostStats. Requires the scheduler task. */
+#define schedTICK_COST_STATS 0
+
 /* Maximum number of periodic tasks that can be created. (Scheduler task is
  * not included) */
-#define schedMAX_NUMBER_OF_PERIODIC_TASKS 5
+#if( schedTICK_COST_STATS == 1 )
+	/* Room for a release benchmark with many tasks. */
+	#define schedMAX_NUMBER_OF_PERIODIC_TASKS 16
+#else
+	#define schedMAX_NUMBER_OF_PERIODIC_TASKS 5
+#endif /* schedTICK_COST_STATS */
 
 /* Set this define to 1 to enable Timing-Error-Detection for detecting tasks
  * that have missed their deadlines. Tasks that have missed their deadlines
@@ -47,6 +62,106 @@ extern "C" {
  * their worst-case execution time will be preempted until next period. */
 #define schedUSE_TIMING_ERROR_DETECTION_EXECUTION_TIME 1
 
+/* Set this define to 1 to enable (m,k)-firm deadlines. A task given an (m,k)
+ * constraint with vSchedulerPeriodicTaskSetMKFirm must meet the deadlines of at
+ * least m out of any k consecutive jobs. Whether a job met its deadline is
+ * recorded when the job completes; a late job is left to finish. The task set
+ * is considered overloaded after a deadline miss or a job overrunning its
+ * period; while it is, optional jobs are skipped at release time so that
+ * mandatory jobs get the processor time instead. Overruns of running jobs are
+ * detected by the scheduler task. */
+#define schedUSE_MK_FIRM 0
+
+#if( schedUSE_MK_FIRM == 1 )
+	/* Largest supported k. The outcomes of recent jobs are kept in a 32-bit mask. */
+	#define schedMK_MAX_K 32
+	/* Time in software ticks the task set is considered overloaded after a miss or an overrun. */
+	#define schedMK_OVERLOAD_HOLD_TICKS pdMS_TO_TICKS( 1000 )
+#endif /* schedUSE_MK_FIRM */
+
+/* Set this define to 1 to enable preemption-threshold scheduling. Jobs of a
+ * periodic task run at its preemption threshold, which is at or above its RMS
+ * priority, so only tasks with a priority above the threshold can preempt them.
+ * RMS priority levels are assigned two apart and thresholds lie between them,
+ * so a threshold never equals the priority of another task, which would only
+ * make the two time slice. vSchedulerStart assigns the highest thresholds that
+ * keep the task set schedulable. Requires the RMS scheduling policy, and
+ * configMAX_PRIORITIES of at least 2n + 1 for n distinct periods. */
+#define schedUSE_PREEMPTION_THRESHOLD 0
+
+#if( schedUSE_PREEMPTION_THRESHOLD == 1 )
+	/* Set this define to 1 to print the assigned thresholds, the groups of
+	 * mutually non-preemptive tasks and the context switch bound from
+	 * vSchedulerStart. Every task here still has its own stack, because a
+	 * blocked FreeRTOS task keeps its context on it. The printed shared stack
+	 * size is a hypothetical lower bound for a run-to-completion design, in
+	 * which a group could use one stack sized for its largest member. */
+	#define schedPRINT_PREEMPTION_THRESHOLD_REPORT 1
+#endif /* schedUSE_PREEMPTION_THRESHOLD */
+
+/* Set this define to 1 to count context switches and preemptions of periodic
+ * jobs in the tick hook. The running task is sampled once per tick, so switches
+ * that start and end within one tick are not seen. Print the counts with
+ * vSchedulerPrintContextSwitchStats and compare runs of the same sketch with
+ * schedUSE_PREEMPTION_THRESHOLD set to 0 and 1. Requires the scheduler task. */
+#define schedCONTEXT_SWITCH_STATS 0
+
+/* Set this define to 1 to enable elastic periods. The period of a task made
+ * elastic with vSchedulerPeriodicTaskSetElastic is stretched between its minimum
+ * and maximum period, in proportion to its elasticity, whenever the measured
+ * utilization would exceed the RMS schedulable bound. Periods go back towards the
+ * minimum when the load drops. The utilization of a task is computed from its
+ * longest measured job since the last adaptation. Execution-time enforcement
+ * (schedUSE_TIMING_ERROR_DETECTION_EXECUTION_TIME) does not stop jobs of tasks
+ * with a nonzero elasticity at their worst-case execution time, so that their
+ * overruns are measured and absorbed by stretching periods; other tasks are
+ * still stopped at it, so their measured time never exceeds it.
+ * Requires the scheduler task. */
+#define schedUSE_ELASTIC_PERIODS 0
+
+#if( schedUSE_ELASTIC_PERIODS == 1 )
+	/* Number of scheduler task periods between two period adaptations. */
+	#define schedELASTIC_ADAPTATION_INTERVAL 10
+#endif /* schedUSE_ELASTIC_PERIODS */
+
+/* Set this define to 1 to release periodic jobs from a central release engine
+ * in the tick hook instead of a vTaskDelayUntil call in every task. Release times
+ * are kept in a timer wheel, and all releases due on a tick are handled in one
+ * pass with direct task notifications. Release times advance by exactly one period
+ * per job, so they do not drift across overruns or deadline-miss restarts.
+ * Periodic task functions must not use the task notification themselves.
+ * Requires the scheduler task. */
+#define schedUSE_RELEASE_ENGINE 0
+
+#if( schedUSE_RELEASE_ENGINE == 1 )
+	/* Number of timer wheel slots. Must be a power of two. */
+	#define schedRELEASE_WHEEL_SIZE 16
+#endif /* schedUSE_RELEASE_ENGINE */
+
+/* Set this define to 1 to learn worst-case execution times instead of enforcing
+ * them. Execution-time enforcement is disabled and the execution time of every
+ * job is recorded in a per-task histogram. Once every task has completed
+ * schedWCET_CALIBRATION_WINDOW jobs, the scheduler task prints the observed
+ * maximum, two high percentiles and a budget of maximum plus margin for each
+ * task, a SchedTaskBudget_t table of these budgets for
+ * vSchedulerPeriodicTaskSetBudgets, and whether the task set is schedulable
+ * with them. Requires the scheduler task and the RMS policy. */
+#define schedUSE_WCET_CALIBRATION 0
+
+#if( schedUSE_WCET_CALIBRATION == 1 )
+	/* Number of jobs recorded per task. */
+	#define schedWCET_CALIBRATION_WINDOW 100
+	/* Safety margin added to the observed maximum, in percent. */
+	#define schedWCET_MARGIN_PERCENT 20
+	/* Percentiles reported besides the maximum. */
+	#define schedWCET_PERCENTILE_LOW 95
+	#define schedWCET_PERCENTILE_HIGH 99
+	/* Histogram bins per task, and the width of a bin in software ticks. Longer
+	 * execution times are collected in the last bin. */
+	#define schedWCET_HISTOGRAM_BINS 16
+	#define schedWCET_HISTOGRAM_BIN_TICKS 2
+#endif /* schedUSE_WCET_CALIBRATION */
+
 /* Set this define to 1 to enable the scheduler task. This define must be set to 1
 * when using following features:
 * EDF scheduling policy, Timing-Error-Detection of execution time,
@@ -85,6 +200,68 @@ void vSchedulerPeriodicTaskCreate( TaskFunction_t pvTaskCode, const char *pcName
 /* Deletes a periodic task associated with the given task handle. */
 void vSchedulerPeriodicTaskDelete( TaskHandle_t xTaskHandle );
 
+#if( schedUSE_MK_FIRM == 1 )
+	/* Gives a periodic task an (m,k)-firm constraint. Must be called after
+	 * vSchedulerPeriodicTaskCreate and before vSchedulerStart.
+	 *
+	 * pxCreatedTask: The task handle pointer passed to vSchedulerPeriodicTaskCreate.
+	 * uxM: Number of jobs that must meet their deadline in any window of uxK jobs.
+	 * uxK: Window size in jobs. 0 < uxM <= uxK <= schedMK_MAX_K.
+	 * */
+	void vSchedulerPeriodicTaskSetMKFirm( TaskHandle_t *pxCreatedTask, UBaseType_t uxM, UBaseType_t uxK );
+#endif /* schedUSE_MK_FIRM */
+
+#if( schedUSE_ELASTIC_PERIODS == 1 )
+	/* Makes the period of a periodic task elastic. Must be called after
+	 * vSchedulerPeriodicTaskCreate and before vSchedulerStart. The task starts
+	 * with its minimum period, and RMS priorities are assigned from it.
+	 *
+	 * pxCreatedTask: The task handle pointer passed to vSchedulerPeriodicTaskCreate.
+	 * xMinPeriodTick: Nominal (shortest) period given in software ticks.
+	 * xMaxPeriodTick: Longest acceptable period given in software ticks. Priorities
+	 * are not reassigned, so the period is also kept at or below the minimum period
+	 * of every lower-priority task.
+	 * uxElasticity: Elastic coefficient. Tasks with larger coefficients are
+	 * stretched more. 0 keeps the period at its minimum.
+	 * */
+	void vSchedulerPeriodicTaskSetElastic( TaskHandle_t *pxCreatedTask, TickType_t xMinPeriodTick, TickType_t xMaxPeriodTick, UBaseType_t uxElasticity );
+#endif /* schedUSE_ELASTIC_PERIODS */
+
+/* Worst-case execution time of a periodic task, looked up by task name. A
+ * table of these is printed by WCET calibration (schedUSE_WCET_CALIBRATION). */
+typedef struct xSchedTaskBudget
+{
+	const char *pcName;				/* Name given to vSchedulerPeriodicTaskCreate. */
+	TickType_t xMaxExecTimeTick;	/* Worst-case execution time given in software ticks. */
+} SchedTaskBudget_t;
+
+/* Replaces the worst-case execution times of the created periodic tasks with
+ * the ones in the given table. Tasks are matched by name; tasks without an entry
+ * keep their time. Must be called after vSchedulerPeriodicTaskCreate and before
+ * vSchedulerStart.
+ *
+ * pxBudgets: Table of budgets.
+ * uxBudgetCount: Number of entries in the table.
+ * */
+void vSchedulerPeriodicTaskSetBudgets( const SchedTaskBudget_t *pxBudgets, UBaseType_t uxBudgetCount );
+
+#if( schedTICK_COST_STATS == 1 )
+	/* Marks the start of tick processing. Meant to be called from
+	 * traceTASK_INCREMENT_TICK, see schedTICK_COST_STATS. */
+	void vSchedulerTraceTickStart( void );
+
+	/* Prints the number of released jobs, the number of measured ticks, and the
+	 * total and worst-case time in microseconds spent in tick processing. */
+	void vSchedulerPrintTickCostStats( void );
+#endif /* schedTICK_COST_STATS */
+
+#if( schedCONTEXT_SWITCH_STATS == 1 )
+	/* Prints the sampled number of context switches and of preempted periodic
+	 * jobs since vSchedulerStart. With preemption thresholds, the analytic upper
+	 * bound on preemptions over the same time is printed next to them. */
+	void vSchedulerPrintContextSwitchStats( void );
+#endif /* schedCONTEXT_SWITCH_STATS */
+
 /* Starts scheduling tasks. */
 void vSchedulerStart( void );
 